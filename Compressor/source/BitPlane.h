@@ -0,0 +1,238 @@
+/*
+ * BitPlane.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _BITPLANE_H_
+#define _BITPLANE_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+/* error-bounded quantization of the wavelet survivors ("Quantization:" in the header).
+   the survivors of a block are rounded to integer multiples of the step (the wavelet
+   threshold: the error of a survivor is at most half of what the thresholding may drop)
+   and their magnitudes are stored as bit planes, most significant first. the survivors come
+   in the order of FullTransform::threshold: level by level, the coarsest first, and within
+   a level subband by subband, each in the scan order of the block. the planes are stored
+   by segments of SEGMENT of them, each with the planes it needs:
+
+	[1][planes][0][0][float step] { [planes of the segment][signs][plane p-1] ... [plane 0] } ...
+
+   a sign or a plane has one bit per survivor of the segment. the decoding can stop at any
+   plane. a block that would not get smaller, or whose step is not positive, keeps its
+   survivors as they are:
+
+	[0][0][0][0][0][0][0][0][n survivors] */
+namespace BitPlane
+{
+	enum Format { none = 0, bitplane = 1 };
+
+	enum
+	{
+		HEADER = 8,
+		SEGMENT = 64,
+		MAXPLANES = 30	// magnitudes up to 2^30 steps, larger ones are not quantized
+	};
+
+	inline const char * name(const int format)
+	{
+		return format == bitplane ? "bitplane" : "no";
+	}
+
+	/* -1 if unknown */
+	inline int parse(const std::string s)
+	{
+		if (s == "no") return none;
+		if (s == "bitplane") return bitplane;
+		return -1;
+	}
+
+	/* n bits, bit i from bit p of v[i], into (n + 7) / 8 bytes */
+	inline void _pack(const unsigned int * const v, const int n, const int p, unsigned char * const out)
+	{
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			unsigned int b = 0;
+			for(int l = 0; l < 8; ++l)
+				b |= (v[i + l] >> p & 1) << l;
+
+			out[i / 8] = b;
+		}
+
+		if (i < n)
+		{
+			unsigned int b = 0;
+			for(int l = 0; i + l < n; ++l)
+				b |= (v[i + l] >> p & 1) << l;
+
+			out[i / 8] = b;
+		}
+	}
+
+	inline void _unpack(const unsigned char * const in, const int n, const int p, unsigned int * const v)
+	{
+		for(int i = 0; i < n; ++i)
+			v[i] |= (in[i >> 3] >> (i & 7) & 1u) << p;
+	}
+
+	/* bit planes of the magnitude m */
+	inline int _planes(const unsigned int m)
+	{
+		return m ? 32 - __builtin_clz(m) : 0;
+	}
+
+	/* the n survivors into out, through the n magnitudes of scratch (bit 31: sign).
+	   returns the bytes written: they are at most n * sizeof(T) + HEADER */
+	template<typename T>
+	int encode(const T * const survivors, const int n, const float step, unsigned int * const scratch, unsigned char * const out)
+	{
+		const int raw = HEADER + n * (int)sizeof(T);
+
+		int planes = MAXPLANES + 1, nbytes = HEADER;
+
+		if (step > 0)
+		{
+			const double inv = 1. / step;
+
+			planes = 0;
+
+			for(int s = 0; s < n && planes <= MAXPLANES; s += SEGMENT)
+			{
+				const int len = std::min((int)SEGMENT, n - s);
+
+				unsigned int mor = 0;
+
+				for(int i = s; i < s + len; ++i)
+				{
+					const double q = std::fabs((double)survivors[i]) * inv + 0.5;
+					const unsigned int m = q < (double)(1u << MAXPLANES) ? (unsigned int)q : ~0u;
+
+					scratch[i] = m | (unsigned int)(survivors[i] < 0) << 31;
+					mor |= m;
+				}
+
+				planes = std::max(planes, _planes(mor));
+				nbytes += 1 + (1 + _planes(mor)) * ((len + 7) / 8);
+			}
+		}
+
+		if (planes > MAXPLANES || nbytes >= raw)
+		{
+			memmove(out + HEADER, survivors, n * sizeof(T));
+			memset(out, 0, HEADER);
+			return raw;
+		}
+
+		memset(out, 0, HEADER);
+		out[0] = 1;
+		out[1] = planes;
+		memcpy(out + 4, &step, sizeof(step));
+
+		unsigned char * ptr = out + HEADER;
+
+		for(int s = 0; s < n; s += SEGMENT)
+		{
+			const int len = std::min((int)SEGMENT, n - s);
+			const int planebytes = (len + 7) / 8;
+
+			unsigned int mor = 0;
+			for(int i = s; i < s + len; ++i)
+				mor |= scratch[i] & 0x7fffffffu;
+
+			const int p0 = _planes(mor);
+
+			*ptr++ = p0;
+
+			_pack(scratch + s, len, 31, ptr);
+			ptr += planebytes;
+
+			for(int p = p0 - 1; p >= 0; --p, ptr += planebytes)
+				_pack(scratch + s, len, p, ptr);
+		}
+
+		assert(ptr - out == nbytes);
+
+		return nbytes;
+	}
+
+	/* the n survivors back into out (which may overlap in), from at most maxplanes planes.
+	   the value of a survivor whose last planes are not read is the middle of its interval.
+	   false if the nbytes of in do not hold n survivors */
+	template<typename T>
+	bool decode(const unsigned char * const in, const int nbytes, const int n, unsigned int * const scratch, T * const out, const int maxplanes = MAXPLANES)
+	{
+		if (nbytes < HEADER)
+			return false;
+
+		if (in[0] == 0)
+		{
+			if (nbytes != HEADER + n * (int)sizeof(T))
+				return false;
+
+			memmove(out, in + HEADER, n * sizeof(T));
+			return true;
+		}
+
+		assert(maxplanes >= 1 && maxplanes <= MAXPLANES);
+
+		const int planes = in[1];
+
+		if (planes > MAXPLANES)
+			return false;
+		const int cut = planes > maxplanes ? planes - maxplanes : 0;
+
+		float step;
+		memcpy(&step, in + 4, sizeof(step));
+
+		memset(scratch, 0, n * sizeof(unsigned int));
+
+		const unsigned char * ptr = in + HEADER;
+		const unsigned char * const end = in + nbytes;
+
+		for(int s = 0; s < n; s += SEGMENT)
+		{
+			const int len = std::min((int)SEGMENT, n - s);
+			const int planebytes = (len + 7) / 8;
+
+			if (ptr >= end)
+				return false;
+
+			const int p0 = *ptr++;
+
+			if (p0 > planes || end - ptr < (1 + p0) * planebytes)
+				return false;
+
+			_unpack(ptr, len, 31, scratch + s);
+			ptr += planebytes;
+
+			for(int p = p0 - 1; p >= cut; --p)
+				_unpack(ptr + (p0 - 1 - p) * planebytes, len, p, scratch + s);
+
+			ptr += p0 * planebytes;
+		}
+
+		const double half = cut > 0 ? (double)(1u << (cut - 1)) : 0;
+
+		for(int i = 0; i < n; ++i)
+		{
+			const double v = ((scratch[i] & 0x7fffffffu) + half) * step;
+			out[i] = (T)(scratch[i] >> 31 ? -v : v);
+		}
+
+		return ptr == end;
+	}
+}
+
+#endif
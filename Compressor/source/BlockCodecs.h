@@ -0,0 +1,391 @@
+/*
+ * BlockCodecs.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _BLOCKCODECS_H_
+#define _BLOCKCODECS_H_ 1
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "WaveletCompressor.h"
+
+#if defined(_USE_FPZIP_)
+extern "C"
+{
+#include "myfpzip.h"
+}
+#endif
+
+#if defined(_USE_ZFP_)
+#include "myzfp.h"
+#endif
+
+#if defined(_USE_SZ_)
+extern "C"
+{
+#include "rw.h"
+#include "sz.h"
+}
+#endif
+
+/* the first stage: a codec turns a block of _BLOCKSIZE_^3 values (x fastest) into a
+   stream of bytes and back. one instance per thread, the codecs keep their buffers */
+class BlockCodec
+{
+public:
+
+	enum { NPTS = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_ };
+
+	virtual ~BlockCodec() { }
+
+	/* block into out (room for 4 * NPTS * sizeof(Real) bytes at least), returns the bytes
+	   written. block is used as scratch */
+	virtual int compress(Real * const block, unsigned char * const out) = 0;
+
+	virtual void decompress(const unsigned char * const in, const int nbytes, Real * const block) = 0;
+};
+
+/* the codecs of the build and their "Wavelets:" entries in the header: the name of the
+   wavelets (see WaveletsOnInterval::ChosenWavelets_GetName), "fpzip", "zfp", "sz" or "none".
+   wavz and none are in every build, fpzip, zfp and sz in the builds linked with them. the
+   flags of the build (wavz=1, fpzip=1, ...) choose the default of hdf2cz */
+namespace BlockCodecs
+{
+	enum Kind { none = 0, wavz = 1, fpzip = 2, zfp = 3, sz = 4 };
+
+#if defined(_USE_WAVZ_)
+	enum { DEFAULT = wavz };
+#elif defined(_USE_FPZIP_)
+	enum { DEFAULT = fpzip };
+#elif defined(_USE_ZFP_)
+	enum { DEFAULT = zfp };
+#elif defined(_USE_SZ_)
+	enum { DEFAULT = sz };
+#else
+	enum { DEFAULT = none };
+#endif
+
+	/* the option of hdf2cz */
+	inline const char * kind_name(const int kind)
+	{
+		switch (kind)
+		{
+			case wavz: return "wavz";
+			case fpzip: return "fpzip";
+			case zfp: return "zfp";
+			case sz: return "sz";
+			default: return "none";
+		}
+	}
+
+	/* -1 if unknown */
+	inline int parse_kind(const std::string s)
+	{
+		for(int k = none; k <= sz; ++k)
+			if (s == kind_name(k)) return k;
+		return -1;
+	}
+
+	inline bool available(const int kind)
+	{
+		switch (kind)
+		{
+			case none: case wavz: return true;
+#if defined(_USE_FPZIP_)
+			case fpzip: return true;
+#endif
+#if defined(_USE_ZFP_)
+			case zfp: return true;
+#endif
+#if defined(_USE_SZ_)
+			case sz: return true;
+#endif
+			default: return false;
+		}
+	}
+
+	enum { MAXWTYPE = 6 };
+
+	/* the "Wavelets:" entry */
+	inline std::string name(const int kind, const int wtype)
+	{
+		return kind == wavz ? WaveletsOnInterval::ChosenWavelets_GetName(wtype) : kind_name(kind);
+	}
+
+	/* the kind of a "Wavelets:" entry, -1 if unknown. wtype gets the wavelets of wavz */
+	inline int parse(const std::string s, int& wtype)
+	{
+		for(int w = 1; w <= MAXWTYPE; ++w)
+			if (s == WaveletsOnInterval::ChosenWavelets_GetName(w))
+			{
+				wtype = w;
+				return wavz;
+			}
+
+		return parse_kind(s);
+	}
+
+	/* what a codec needs: the wavelet parameters are ignored by the others */
+	struct Settings
+	{
+		int kind;
+		float threshold;	// wavelet threshold, fpzip precision, zfp or sz accuracy
+		int wtype, halffloat, sigmap, quantizer, maxplanes;
+		int shuffle;		// of the wavelet survivors, of the output of the others
+		ZeroBits::Settings zerobits;	// of the wavelet survivors, of the data of none
+
+		Settings(const int kind = DEFAULT):
+		kind(kind), threshold(0), wtype(3), halffloat(HalfFloat::none),
+		sigmap(SignificanceMap::bitset), quantizer(BitPlane::none), maxplanes(BitPlane::MAXPLANES),
+		shuffle(Shuffle::DEFAULT) { }
+	};
+
+	class Wavelets: public BlockCodec
+	{
+		const Settings settings;
+		WaveletCompressor * const compressor;	// 2 * _BLOCKSIZE_^3 values: not on the stack
+
+	public:
+
+		Wavelets(const Settings& settings): settings(settings), compressor(new WaveletCompressor)
+		{
+			compressor->set_sigmap(settings.sigmap);
+			compressor->set_quantizer(settings.quantizer, settings.maxplanes);
+			compressor->set_shuffle(settings.shuffle);
+			compressor->set_zerobits(settings.zerobits);
+		}
+
+		~Wavelets() { delete compressor; }
+
+		/* for the batched transforms and the levels of detail */
+		WaveletCompressor& get_compressor() { return *compressor; }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			memcpy(&compressor->uncompressed_data()[0][0][0], block, sizeof(Real) * NPTS);
+
+			const int nbytes = compressor->compress(settings.threshold, settings.halffloat, settings.wtype);
+			memcpy(out, compressor->compressed_data(), nbytes);
+
+			return nbytes;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			memcpy(compressor->compressed_data(), in, nbytes);
+			compressor->decompress(settings.halffloat, nbytes, settings.wtype, (Real (*)[_BLOCKSIZE_][_BLOCKSIZE_])block);
+		}
+	};
+
+	class None: public BlockCodec
+	{
+		const ZeroBits::Settings zerobits;
+
+	public:
+
+		None(const Settings& settings): zerobits(settings.zerobits) { }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			// set some bits to zero
+			ZeroBits::apply(zerobits, block, NPTS);
+
+			memcpy(out, block, sizeof(Real) * NPTS);
+
+			return sizeof(Real) * NPTS;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			memcpy(block, in, nbytes);
+		}
+	};
+
+#if defined(_USE_FPZIP_)
+	class Fpzip: public BlockCodec
+	{
+		const int prec;
+
+	public:
+
+		Fpzip(const Settings& settings): prec((int)settings.threshold) { }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			const int inbytes = sizeof(Real) * NPTS;
+			int nbytes;
+
+			int is_float = (sizeof(Real)==4)? 1 : 0;
+			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
+			fpz_compress3D((void *)block, inbytes, layout, (void *)out, (unsigned int *)&nbytes, is_float, prec);
+
+			return nbytes;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
+			int is_float = (sizeof(Real)==4)?1:0;
+			int fpz_decompressedbytes;
+
+			fpz_decompress3D((char *)in, nbytes, layout, (char *)block, (unsigned int *)&fpz_decompressedbytes, is_float, prec);
+			if ((fpz_decompressedbytes < 0)||(fpz_decompressedbytes != NPTS*sizeof(Real)))
+			{
+				printf("FPZ DECOMPRESSION FAILURE:  %d!!\n", fpz_decompressedbytes);
+				abort();
+			}
+		}
+	};
+#endif
+
+#if defined(_USE_ZFP_)
+	class Zfp: public BlockCodec
+	{
+		const double zfp_acc;
+
+	public:
+
+		Zfp(const Settings& settings): zfp_acc(settings.threshold) { }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			int is_float = (sizeof(Real)==4)? 1 : 0;
+			size_t nbytes_zfp;
+			int status = zfp_compress_buffer(block, _BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, zfp_acc, is_float, out, &nbytes_zfp);
+#if VERBOSE
+			printf("zfp_compress status = %d, from %d to %d bytes\n", status, (int)(NPTS*sizeof(Real)), (int)nbytes_zfp);
+#endif
+			return nbytes_zfp;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			int is_float = (sizeof(Real)==4)?1:0;
+			size_t zfp_decompressedbytes;
+
+			int status = zfp_decompress_buffer(block, _BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, zfp_acc, is_float, (unsigned char *)in, nbytes, &zfp_decompressedbytes);
+			if ((status < 0)||(zfp_decompressedbytes != NPTS*sizeof(Real)))
+			{
+				printf("ZFP DECOMPRESSION FAILURE:  %ld!!\n", zfp_decompressedbytes);
+				abort();
+			}
+		}
+	};
+#endif
+
+#if defined(_USE_SZ_)
+	class Sz: public BlockCodec
+	{
+		const double sz_abs_acc;
+
+	public:
+
+		Sz(const Settings& settings): sz_abs_acc(settings.threshold) { }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			int is_float = (sizeof(Real)==4)? 1 : 0;
+
+			size_t bytes_sz;
+			unsigned char *compressed_sz = SZ_compress_args(is_float? SZ_FLOAT:SZ_DOUBLE, (unsigned char *)block, &bytes_sz, ABS, sz_abs_acc, 0.0, 0.0, SZ_PWR_MAX_TYPE, 0, 0, _BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_);
+
+			const int nbytes = bytes_sz;
+			memcpy(out, compressed_sz, nbytes);
+			free(compressed_sz);
+
+#if VERBOSE
+			printf("SZ_compress_args: from %d to %d bytes\n", (int)(NPTS*sizeof(Real)), nbytes);
+#endif
+			return nbytes;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			int is_float = (sizeof(Real)==4)?1:0;
+			int sz_decompressedbytes;
+
+			sz_decompressedbytes = SZ_decompress_args(is_float?SZ_FLOAT:SZ_DOUBLE, (unsigned char *)in, nbytes, block, 0, 0, _BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_);
+			sz_decompressedbytes *= sizeof(Real);
+			if ((sz_decompressedbytes < 0)||(sz_decompressedbytes != NPTS*sizeof(Real)))
+			{
+				printf("SZ DECOMPRESSION FAILURE:  %d!!\n", sz_decompressedbytes);
+				abort();
+			}
+		}
+	};
+#endif
+
+	/* the output of a codec through the shuffle, with elements of sizeof(Real) bytes */
+	class Shuffled: public BlockCodec
+	{
+		BlockCodec * const codec;
+		const int shuffle;
+		std::vector<unsigned char> buf;	// the unshuffled stream
+
+	public:
+
+		Shuffled(BlockCodec * codec, const int shuffle): codec(codec), shuffle(shuffle) { }
+
+		~Shuffled() { delete codec; }
+
+		int compress(Real * const block, unsigned char * const out)
+		{
+			const int nbytes = codec->compress(block, out);
+			Shuffle::encode(shuffle, out, nbytes, sizeof(Real));
+
+			return nbytes;
+		}
+
+		void decompress(const unsigned char * const in, const int nbytes, Real * const block)
+		{
+			buf.assign(in, in + nbytes);
+			Shuffle::decode(shuffle, &buf.front(), nbytes, sizeof(Real));
+
+			codec->decompress(&buf.front(), nbytes, block);
+		}
+	};
+
+	inline BlockCodec * _create(const Settings& settings)
+	{
+		switch (settings.kind)
+		{
+			case none: return new None(settings);
+			case wavz: return new Wavelets(settings);
+#if defined(_USE_FPZIP_)
+			case fpzip: return new Fpzip(settings);
+#endif
+#if defined(_USE_ZFP_)
+			case zfp: return new Zfp(settings);
+#endif
+#if defined(_USE_SZ_)
+			case sz: return new Sz(settings);
+#endif
+			default: return NULL;
+		}
+	}
+
+	/* a new codec, NULL if not in the build */
+	inline BlockCodec * create(const Settings& settings)
+	{
+		BlockCodec * const codec = _create(settings);
+
+		if (codec == NULL || settings.kind == wavz || settings.shuffle == Shuffle::none)
+			return codec;
+
+		return new Shuffled(codec, settings.shuffle);
+	}
+}
+
+#endif
@@ -11,78 +11,210 @@
 #ifndef _COMPRESSIONENCODERS_H_
 #define _COMPRESSIONENCODERS_H_ 1
 
-#if defined(_USE_LZ4_)
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-#endif
-
 #include <zlib.h>	// always needed
+#include "ZStreams.h"
 
 #if defined(_USE_LZ4_)
+#include <vector>
 #include <lz4.h>
+#if defined(LZ4_VERSION_NUMBER) && LZ4_VERSION_NUMBER >= 10700
+#include <lz4hc.h>
+#define _LZ4_TUNABLE_ 1	/* LZ4_compress_fast and LZ4-HC, not in the bundled lz4 */
 #endif
+#endif
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "RansCoder.h"
+
+/* the second stage ("Encoder:" in the header), chosen at run time and read back from the
+   header: zlib, rans and none are in every build, lz4 in the builds with lz4=1. the encoder
+   flags of the build (zlib=1, lz4=1, rans=1) choose the default of hdf2cz.
 
-#if defined(_USE_FPZIP_)
-extern "C"
+   adaptive picks the encoder of each chunk and stores it in front of the chunk:
+
+	[1 byte: the Format of the chunk][the chunk with that encoder]
+
+   a sample of the chunk whose estimated ratio is below minratio is stored as it is (none),
+   the others with lz4 (policy speed, zlib at its fastest level without lz4) or zlib (policy
+   ratio). a chunk that would not get smaller is stored as it is */
+namespace Encoder
 {
-#include "myfpzip.h"
-}
+	enum Format { none = 0, zlib = 1, lz4 = 2, rans = 3, adaptive = 4 };
+	enum Policy { speed = 0, ratio = 1 };
+
+#if defined(_USE_ZLIB_)
+	enum { DEFAULT = zlib };
+#elif defined(_USE_LZ4_)
+	enum { DEFAULT = lz4 };
+#elif defined(_USE_RANS_)
+	enum { DEFAULT = rans };
+#else
+	enum { DEFAULT = none };
 #endif
 
-#if defined(_USE_ZFP_)
-#include "myzfp.h"
+	inline const char * name(const int format)
+	{
+		switch (format)
+		{
+			case zlib: return "zlib";
+			case lz4: return "lz4";
+			case rans: return "rans";
+			case adaptive: return "adaptive";
+			default: return "none";
+		}
+	}
+
+	/* -1 if unknown */
+	inline int parse(const std::string s)
+	{
+		if (s == "none") return none;
+		if (s == "zlib") return zlib;
+		if (s == "lz4") return lz4;
+		if (s == "rans") return rans;
+		if (s == "adaptive") return adaptive;
+		return -1;
+	}
+
+	/* can this build encode and decode it */
+	inline bool available(const int format)
+	{
+#if defined(_USE_LZ4_)
+		return format >= none && format <= adaptive;
+#else
+		return format >= none && format <= adaptive && format != lz4;
 #endif
+	}
 
-#if defined(_USE_SZ_)
-extern "C"
-{
-#include "rw.h"
-#include "sz.h"
+	/* -1 if unknown */
+	inline int parse_strategy(const std::string s)
+	{
+		if (s == "default") return Z_DEFAULT_STRATEGY;
+		if (s == "filtered") return Z_FILTERED;
+		if (s == "huffman") return Z_HUFFMAN_ONLY;
+		if (s == "rle") return Z_RLE;
+		return -1;
+	}
+
+	/* -1 if unknown */
+	inline int parse_policy(const std::string s)
+	{
+		if (s == "speed") return speed;
+		if (s == "ratio") return ratio;
+		return -1;
+	}
+
+	/* the format and how hard to encode: the decoder only needs the format */
+	struct Settings
+	{
+		int format;
+		int zlevel, zstrategy;			// zlib
+		int lz4acceleration, lz4hclevel;	// lz4, lz4hclevel 0: no LZ4-HC
+		int policy;				// adaptive
+		float minratio;
+
+		Settings(const int format = DEFAULT):
+		format(format), zlevel(Z_DEFAULT_COMPRESSION), zstrategy(Z_DEFAULT_STRATEGY),
+		lz4acceleration(1), lz4hclevel(0), policy(ratio), minratio(1.1f) { }
+	};
+
+	enum { NSAMPLES = 16, SAMPLEBYTES = 1024 };
+
+	/* the compression ratio of an order-0 entropy coder on NSAMPLES slices of the chunk:
+	   a cheap probe, the LZ77 encoders may do better on repeated strings */
+	inline float estimate_ratio(const unsigned char * const buf, const unsigned len)
+	{
+		unsigned int hist[256] = {0};
+
+		const unsigned slice = std::min((unsigned)SAMPLEBYTES, len / NSAMPLES);
+		unsigned n = 0;
+
+		if (slice == 0)
+		{
+			for(unsigned i = 0; i < len; ++i)
+				++hist[buf[i]];
+			n = len;
+		}
+		else
+			for(int s = 0; s < NSAMPLES; ++s)
+			{
+				const unsigned char * const ptr = buf + (len - slice) / (NSAMPLES - 1) * s;
+				for(unsigned i = 0; i < slice; ++i)
+					++hist[ptr[i]];
+				n += slice;
+			}
+
+		double bits = 0;
+		for(int c = 0; c < 256; ++c)
+			if (hist[c])
+				bits -= hist[c] * std::log2((double)hist[c] / n);
+
+		return bits > 0 ? 8. * n / bits : 8;
+	}
 }
-#endif
 
 inline int deflate_inplace(z_stream *strm, unsigned char *buf, unsigned len, unsigned *max);
-inline size_t zdecompress(unsigned char * inputbuf, size_t ninputbytes, unsigned char * outputbuf, const size_t maxsize);
+inline size_t zdecompress(unsigned char * inputbuf, size_t ninputbytes, unsigned char * outputbuf, const size_t maxsize, const int encoder);
 
-inline size_t zdecompress(unsigned char * inputbuf, size_t ninputbytes, unsigned char * outputbuf, const size_t maxsize)
+inline size_t zdecompress(unsigned char * inputbuf, size_t ninputbytes, unsigned char * outputbuf, const size_t maxsize, const int encoder)
 {
 #if defined(VERBOSE)
 	printf("zdecompress has been called for %d input bytes\n", ninputbytes);
 #endif
 
 	int decompressedbytes = 0;
-#if defined(_USE_ZLIB_)
-	z_stream datastream = {0};
-	datastream.total_in = datastream.avail_in = ninputbytes;
-	datastream.total_out = datastream.avail_out = maxsize;
-	datastream.next_in = inputbuf;
-	datastream.next_out = outputbuf;
-
-	const int retval = inflateInit(&datastream);
 
-	if (retval == Z_OK && inflate(&datastream, Z_FINISH))
+	switch (encoder)
 	{
-		decompressedbytes = datastream.total_out;
-	}
-	else
+	case Encoder::zlib:
 	{
-		printf("ZLIB DECOMPRESSION FAILURE!!\n");
-		abort();
+		z_stream& datastream = *ZStreams::inflate_stream();
+		datastream.avail_in = ninputbytes;
+		datastream.avail_out = maxsize;
+		datastream.next_in = inputbuf;
+		datastream.next_out = outputbuf;
+
+		if (inflate(&datastream, Z_FINISH))
+		{
+			decompressedbytes = datastream.total_out;
+		}
+		else
+		{
+			printf("ZLIB DECOMPRESSION FAILURE!!\n");
+			abort();
+		}
+		break;
 	}
-
-	inflateEnd(&datastream);
-#elif defined(_USE_LZ4_)
-	decompressedbytes = LZ4_uncompress_unknownOutputSize((char *)inputbuf, (char*) outputbuf, ninputbytes, maxsize);
-	if (decompressedbytes < 0)
-	{
-		printf("LZ4 DECOMPRESSION FAILURE!!\n");
+#if defined(_USE_LZ4_)
+	case Encoder::lz4:
+		decompressedbytes = LZ4_uncompress_unknownOutputSize((char *)inputbuf, (char*) outputbuf, ninputbytes, maxsize);
+		if (decompressedbytes < 0)
+		{
+			printf("LZ4 DECOMPRESSION FAILURE!!\n");
+			abort();
+		}
+		break;
+#endif
+	case Encoder::rans:
+		decompressedbytes = Rans::decompress(inputbuf, ninputbytes, outputbuf, maxsize);
+		break;
+	case Encoder::none:
+		decompressedbytes = ninputbytes;
+		memcpy(outputbuf, inputbuf, ninputbytes);
+		break;
+	case Encoder::adaptive:
+		if (ninputbytes < 1 || inputbuf[0] == Encoder::adaptive)
+		{
+			printf("BAD ADAPTIVE CHUNK!!\n");
+			abort();
+		}
+		decompressedbytes = zdecompress(inputbuf + 1, ninputbytes - 1, outputbuf, maxsize, inputbuf[0]);
+		break;
+	default:
+		printf("UNKNOWN ENCODER %d!!\n", encoder);
 		abort();
 	}
-#else
-	decompressedbytes = ninputbytes;
-	memcpy(outputbuf, inputbuf, ninputbytes);
-#endif
 
 	return decompressedbytes;
 }
@@ -113,7 +245,6 @@ inline size_t zdecompress(unsigned char * inputbuf, size_t ninputbytes, unsigned
 inline int deflate_inplace(z_stream *strm, unsigned char *buf, unsigned len,
 						   unsigned *max)
 {
-#if defined(_USE_ZLIB_)
 	int ret;                    /* return code from deflate functions */
 	unsigned have;              /* number of bytes in temp[] */
 	unsigned char *hold;        /* allocated buffer to hold input data */
@@ -188,63 +319,139 @@ inline int deflate_inplace(z_stream *strm, unsigned char *buf, unsigned len,
 	strm->zfree(strm->opaque, hold);
 	*max = strm->next_out - buf;
 	return ret == Z_OK ? Z_BUF_ERROR : (ret == Z_STREAM_END ? Z_OK : ret);
+}
 
-#elif defined(_USE_LZ4_)
+#if defined(_USE_LZ4_)
+/* as deflate_inplace, with LZ4 */
+inline int lz4_inplace(unsigned char *buf, unsigned len, unsigned *max, const int lz4acceleration, const int lz4hclevel)
+{
+	/* scratch of the calling thread, grown to the bound of the largest input: any number
+	   of threads, no memory for the threads that do not compress */
+	static thread_local std::vector<char> bufzlib;
+
+	const int ninputbytes = len;
+	const int bound = LZ4_compressBound(ninputbytes);
 
-	#define ZBUFSIZE (4*1024*1024)	/* hardcoded everywhere */
+	if ((int)bufzlib.size() < bound)
+		bufzlib.resize(bound);
 
-#ifdef _OPENMP
-	#define MAXBUFFERS	12	/* MAX NUMBER OF THREADS */
+	int compressedbytes;
+
+#if defined(_LZ4_TUNABLE_)
+	if (lz4hclevel > 0)
+		compressedbytes = LZ4_compress_HC((char*) buf, &bufzlib.front(), ninputbytes, bound, lz4hclevel);
+	else
+		compressedbytes = LZ4_compress_fast((char*) buf, &bufzlib.front(), ninputbytes, bound, lz4acceleration);
 #else
-	#define MAXBUFFERS	1	
+	compressedbytes = LZ4_compress_limitedOutput((char*) buf, &bufzlib.front(), ninputbytes, bound);
 #endif
 
-	int thread_num = 0;
-	int num_threads = 1;
-#ifdef _OPENMP
-	thread_num = omp_get_thread_num();
-	num_threads = omp_get_num_threads();
+	if (*max < len)
+		*max = len;
+
+	if (compressedbytes <= 0 || compressedbytes > (int)*max)
+		return Z_BUF_ERROR;
+
+	memcpy(buf, &bufzlib.front(), compressedbytes);
+
+	*max = compressedbytes;
+	return Z_OK;
+}
 #endif
 
-	if (num_threads > MAXBUFFERS) {
-		printf("Small number of buffers (%d)\n", MAXBUFFERS);
-		abort();
-	}
+/* as deflate_inplace, with rANS: the byte planes of the shuffled regions of planes, if any,
+   have models of their own */
+inline int rans_inplace(unsigned char *buf, unsigned len, unsigned *max, const Rans::Planes * planes = NULL)
+{
+	static thread_local std::vector<unsigned char> bufrans;
 
-	static char bufzlibA[MAXBUFFERS][ZBUFSIZE];
+	if (bufrans.size() < Rans::bound(len))
+		bufrans.resize(Rans::bound(len));
 
-	if (ZBUFSIZE < *max) {
-		printf("small ZBUFSIZE\n");
-		abort();
-	}
+	const int nregions = planes ? planes->regions.size() : 0;
+	const size_t compressedbytes = Rans::compress(buf, len, &bufrans.front(),
+						      nregions ? &planes->regions.front() : NULL, nregions, planes ? planes->esize : 0);
 
-	char *bufzlib = (char *)&bufzlibA[thread_num][0];
+	if (compressedbytes > std::max(*max, len))
+		return Z_BUF_ERROR;
 
-	int ninputbytes = len;
-	int compressedbytes;
+	memcpy(buf, &bufrans.front(), compressedbytes);
 
-#if (MAXBUFFERS == 1)
-	#pragma omp critical
-#endif
+	*max = compressedbytes;
+	return Z_OK;
+}
+
+inline int encode_inplace(const Encoder::Settings& settings, unsigned char *buf, unsigned len, unsigned *max, const Rans::Planes * planes = NULL);
+
+/* as deflate_inplace, with the encoder of the chunk picked by the policy of settings and its
+   tag in front. *max must be larger than len */
+inline int adaptive_inplace(const Encoder::Settings& settings, unsigned char *buf, unsigned len, unsigned *max)
+{
+	Encoder::Settings chosen(settings);
+	chosen.format = Encoder::none;
+
+	if (Encoder::estimate_ratio(buf, len) >= settings.minratio)
 	{
 #if defined(_USE_LZ4_)
-		compressedbytes = LZ4_compress((char*) buf, (char *) bufzlib, ninputbytes);
+		chosen.format = settings.policy == Encoder::speed ? Encoder::lz4 : Encoder::zlib;
+#else
+		chosen.format = Encoder::zlib;
+		if (settings.policy == Encoder::speed)
+			chosen.zlevel = Z_BEST_SPEED;
 #endif
-		memcpy(buf, bufzlib, compressedbytes);
 	}
 
-	strm->total_out = compressedbytes;
-	*max = compressedbytes;
-        return (compressedbytes >= 0) ? Z_OK : Z_BUF_ERROR;
+	unsigned mah = len;
 
-#else	/* NO COMPRESSION */
+	if (chosen.format != Encoder::none)
+	{
+		/* the chunk of the calling thread, for the chunks that do not get smaller */
+		static thread_local std::vector<unsigned char> raw;
+		raw.assign(buf, buf + len);
+
+		mah = std::max(*max, len);
+		if (encode_inplace(chosen, buf, len, &mah) != Z_OK || mah >= len)
+		{
+			chosen.format = Encoder::none;
+			memcpy(buf, &raw.front(), len);
+			mah = len;
+		}
+	}
 
-	int compressedbytes = len;
-	strm->total_out = compressedbytes;
-	*max = compressedbytes;
-        return Z_OK;
-#endif
+	if (mah + 1 > std::max(*max, len))
+		return Z_BUF_ERROR;
+
+	memmove(buf + 1, buf, mah);
+	buf[0] = chosen.format;
+
+	*max = mah + 1;
+	return Z_OK;
 }
 
+/* buf[0..len-1] in place into buf[0..*max-1] with the encoder of settings, as deflate_inplace:
+   Z_OK and *max set to the bytes written on success. planes: the shuffled regions of buf,
+   for rans */
+inline int encode_inplace(const Encoder::Settings& settings, unsigned char *buf, unsigned len, unsigned *max, const Rans::Planes * planes)
+{
+	switch (settings.format)
+	{
+	case Encoder::zlib:
+		return deflate_inplace(ZStreams::deflate_stream(settings.zlevel, settings.zstrategy), buf, len, max);
+#if defined(_USE_LZ4_)
+	case Encoder::lz4:
+		return lz4_inplace(buf, len, max, settings.lz4acceleration, settings.lz4hclevel);
+#endif
+	case Encoder::rans:
+		return rans_inplace(buf, len, max, planes);
+	case Encoder::adaptive:
+		return adaptive_inplace(settings, buf, len, max);
+	case Encoder::none:
+		*max = len;
+		return Z_OK;
+	default:
+		printf("UNKNOWN ENCODER %d!!\n", settings.format);
+		abort();
+	}
+}
 
 #endif
@@ -0,0 +1,220 @@
+/*
+ * Container.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _CONTAINER_H_
+#define _CONTAINER_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* many dumps in one file: each (step, field) is a record, the bytes of a .cz file as it
+   would be written alone, with its header, metablocks and LUT (block -> chunk) and the
+   offsets in its mini-header relative to the start of the record. the file is
+
+	superblock:	MAGIC, the offset of the index, its capacity and entries, and the end,
+			where the next record goes (SUPERBLOCK bytes at offset 0)
+	records:	one after the other, from SUPERBLOCK on
+	index:		an entry per record, in the order they were appended, with room for
+			capacity entries, somewhere between the records
+
+   a record is appended at the end, its entry goes to the first free one of the index, or
+   to a new index of twice the capacity after the record, and the superblock is written
+   last: until then, the file is the container it was. the bytes of the records already
+   there are never touched, and those of an append that did not finish are overwritten by
+   the next one. a step and field appended twice is found at its last record.
+
+   the superblock and the index are little endian, whatever the byte order of the writer */
+namespace Container
+{
+	struct Entry
+	{
+		size_t offset, bytes;	// of the record in the file
+		int step;
+		char field[44];
+	};
+
+	struct Index
+	{
+		size_t index;	// offset of the entries
+		size_t capacity;	// entries that fit there
+		size_t end;	// of the container, where the next record goes
+		std::vector<Entry> entries;
+	};
+
+	/* a write of bytes at offset */
+	struct Write
+	{
+		size_t offset;
+		std::vector<unsigned char> bytes;
+	};
+
+	enum { SUPERBLOCK = 64, ENTRYBYTES = 64, MINCAPACITY = 16 };
+
+	static const char MAGIC[16] = "CUBISMZ-CONTAIN";
+
+	inline void _put(unsigned char * const p, const unsigned long long v, const int n)
+	{
+		for(int i = 0; i < n; ++i)
+			p[i] = (unsigned char)(v >> (8 * i));
+	}
+
+	inline unsigned long long _get(const unsigned char * const p, const int n)
+	{
+		unsigned long long v = 0;
+		for(int i = 0; i < n; ++i)
+			v |= (unsigned long long)p[i] << (8 * i);
+
+		return v;
+	}
+
+	inline void _encode(const Entry& e, unsigned char * const p)
+	{
+		memset(p, 0, ENTRYBYTES);
+		_put(p, e.offset, 8);
+		_put(p + 8, e.bytes, 8);
+		_put(p + 16, (unsigned int)e.step, 4);
+		memcpy(p + 20, e.field, sizeof(e.field));
+	}
+
+	inline Entry _decode(const unsigned char * const p)
+	{
+		Entry e;
+		e.offset = _get(p, 8);
+		e.bytes = _get(p + 8, 8);
+		e.step = (int)(unsigned int)_get(p + 16, 4);
+		memcpy(e.field, p + 20, sizeof(e.field));
+		e.field[sizeof(e.field) - 1] = 0;
+
+		return e;
+	}
+
+	inline std::vector<unsigned char> _superblock(const Index& ix)
+	{
+		std::vector<unsigned char> bytes(SUPERBLOCK, 0);
+		memcpy(&bytes[0], MAGIC, sizeof(MAGIC));
+		_put(&bytes[16], ix.index, 8);
+		_put(&bytes[24], ix.capacity, 8);
+		_put(&bytes[32], ix.entries.size(), 8);
+		_put(&bytes[40], ix.end, 8);
+
+		return bytes;
+	}
+
+	inline Entry entry(const size_t offset, const size_t bytes, const int step, const std::string field)
+	{
+		if (field.size() >= sizeof(Entry().field))
+		{
+			printf("Container.h: field name %s longer than %d characters!!\n", field.c_str(), (int)sizeof(Entry().field) - 1);
+			abort();
+		}
+
+		Entry e;
+		memset(&e, 0, sizeof(e));
+		e.offset = offset;
+		e.bytes = bytes;
+		e.step = step;
+		strcpy(e.field, field.c_str());
+
+		return e;
+	}
+
+	/* the container at path, empty if there is no such file. false if the file is not a
+	   container */
+	inline bool read(const std::string path, Index& ix)
+	{
+		ix.index = ix.capacity = 0;
+		ix.end = SUPERBLOCK;
+		ix.entries.clear();
+
+		FILE * f = fopen(path.c_str(), "rb");
+
+		if (f == NULL)
+			return true;
+
+		unsigned char superblock[SUPERBLOCK];
+		const size_t n = fread(superblock, 1, SUPERBLOCK, f);
+
+		bool ok = n == 0 && feof(f);
+
+		if (n == SUPERBLOCK && memcmp(superblock, MAGIC, sizeof(MAGIC)) == 0)
+		{
+			ix.index = _get(superblock + 16, 8);
+			ix.capacity = _get(superblock + 24, 8);
+			ix.end = _get(superblock + 40, 8);
+
+			const size_t entries = _get(superblock + 32, 8);
+			std::vector<unsigned char> bytes(entries * ENTRYBYTES);
+
+			ok = entries <= ix.capacity && fseek(f, ix.index, SEEK_SET) == 0 &&
+				(entries == 0 || fread(&bytes.front(), ENTRYBYTES, entries, f) == entries);
+
+			for(size_t i = 0; ok && i < entries; ++i)
+				ix.entries.push_back(_decode(&bytes[i * ENTRYBYTES]));
+		}
+
+		fclose(f);
+
+		return ok;
+	}
+
+	/* the last record of step and field, NULL if there is none */
+	inline const Entry * find(const std::vector<Entry>& entries, const int step, const std::string field)
+	{
+		for(int i = (int)entries.size() - 1; i >= 0; --i)
+			if (entries[i].step == step && field == entries[i].field)
+				return &entries[i];
+
+		return NULL;
+	}
+
+	/* the record e, written at ix.end, is appended to ix. returns the writes that add it to
+	   the file: the last one, of the superblock, must come after the others are in the file */
+	inline std::vector<Write> append(Index& ix, const Entry& e)
+	{
+		std::vector<Write> writes;
+
+		ix.entries.push_back(e);
+		const size_t n = ix.entries.size();
+
+		if (n <= ix.capacity)
+		{
+			Write w = { ix.index + (n - 1) * ENTRYBYTES, std::vector<unsigned char>(ENTRYBYTES) };
+			_encode(e, &w.bytes.front());
+			writes.push_back(w);
+
+			ix.end = e.offset + e.bytes;
+		}
+		else
+		{
+			ix.capacity = std::max((size_t)MINCAPACITY, 2 * ix.capacity);
+			ix.index = e.offset + e.bytes;
+
+			Write w = { ix.index, std::vector<unsigned char>(n * ENTRYBYTES) };
+			for(size_t i = 0; i < n; ++i)
+				_encode(ix.entries[i], &w.bytes[i * ENTRYBYTES]);
+			writes.push_back(w);
+
+			ix.end = ix.index + ix.capacity * ENTRYBYTES;
+		}
+
+		Write w = { 0, _superblock(ix) };
+		writes.push_back(w);
+
+		return writes;
+	}
+}
+
+#endif
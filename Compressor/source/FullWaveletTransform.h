@@ -15,7 +15,9 @@
 
 #include <vector>
 #include <algorithm>
-#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
 
 #include "WaveletsOnInterval.h"	// 4th and 3rd order wavelets in C++ 
 
@@ -31,39 +33,127 @@ namespace WaveletsOnInterval
 		if (wtype == 1) return "InterpWavelet4thOrder";
 		if (wtype == 2) return "LiftedInterpWavelet4thOrder";
 		if (wtype == 3) return "AverageInterpWavelet3rdOrder";
+		if (wtype == 4) return "InterpWavelet4thOrderInPlace";
+		if (wtype == 5) return "LiftedInterpWavelet4thOrderInPlace";
+		if (wtype == 6) return "AverageInterpWavelet3rdOrderInPlace";
 		return "None";
 	}
 	
 	inline const char * ChosenWavelets_GetName(int wtype) { return _name(wtype); } 
 
-	template<int BS, int ROWSIZE, int COLSIZE, int SLICESIZE>
+	/* the sweeps never transpose the data. the x, y, z directions of a level
+	   are found on the axes 2, 1, 0 of data rotated by ROT, and the coefficients
+	   a level produces are addressed in the frame rotated by ROT + 1, which is
+	   exactly the layout the transposing sweeps used to leave behind.
+	   the coarser level therefore works in that frame and the mask/survivor
+	   order of the compressed stream does not change. */
+	template<int R, int ROWSIZE, int COLSIZE>
+	inline int _rotated_offset(const int iz, const int iy, const int ix)
+	{
+		int n[3];
+		
+		n[R % 3] = iz;
+		n[(1 + R) % 3] = iy;
+		n[(2 + R) % 3] = ix;
+		
+		return n[2] + ROWSIZE * (n[1] + COLSIZE * n[0]);
+	}
+	
+	/* bit l is set if |p[l]| > eps, for W consecutive coefficients */
+	template<int W>
+	inline unsigned int _significant(const FwtAp * const p, const FwtAp eps)
+	{
+		typedef typename FwtLanes<W>::V V;
+		typedef typename FwtLanes<W>::M M;
+
+		V v;
+		memcpy(&v, p, sizeof(V));
+
+		const M accepted = (v < 0 ? -v : v) > eps;
+
+		unsigned int bits = 0;
+		for(int l = 0; l < W; ++l)
+			bits |= (accepted[l] & 1u) << l;
+
+		return bits;
+	}
+
+	/* stores W bits at bit b0 of the mask bytes (bit i: byte i / 8, bit i % 8).
+	   fewer than 8 bits share their byte and are or-ed into it */
+	template<int W>
+	inline void _setbits(unsigned char * const mask, const int b0, const unsigned int bits)
+	{
+		if (W >= 8)
+			for(int b = 0; b < W / 8; ++b)
+				mask[b0 / 8 + b] = bits >> (8 * b);
+		else
+			mask[b0 / 8] |= bits << (b0 % 8);
+	}
+
+	/* the W bits at bit b0 of the mask bytes */
+	template<int W>
+	inline unsigned int _getbits(const unsigned char * const mask, const int b0)
+	{
+		unsigned int bits = 0;
+
+		if (W >= 8)
+			for(int b = 0; b < W / 8; ++b)
+				bits |= (unsigned int)mask[b0 / 8 + b] << (8 * b);
+		else
+			bits = mask[b0 / 8] >> (b0 % 8) & ((1u << W) - 1);
+
+		return bits;
+	}
+
+	template<int BS, int ROWSIZE, int COLSIZE, int SLICESIZE, int ROT = 0>
 	struct FullTransformEngine : WaveletSweep< ChosenWavelets, ROWSIZE, COLSIZE>
 	{		
-		FullTransformEngine<BS/2, ROWSIZE, COLSIZE, SLICESIZE> child;
+		enum { COEFFROT = (ROT + 1) % 3 };
 		
-		inline void fwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], int wtype)
+		FullTransformEngine<BS/2, ROWSIZE, COLSIZE, SLICESIZE, COEFFROT> child;
+
+		enum { LEVELS = FullTransformEngine<BS/2, ROWSIZE, COLSIZE, SLICESIZE, COEFFROT>::LEVELS + 1 };	// the coarsest (4^3) included
+		
+		template<int WTYPE>
+		inline void fwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
 		{
-			this->template sweep3D<BS, true>(data, wtype);
+			this->template sweep3D<BS, true, ROT, WTYPE>(data);
 			
-			child.fwt(data, wtype);
+			child.template fwt<WTYPE>(data);
 		}
 		
-		inline void iwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], int wtype)
+		/* lod > 0: the lod finest levels are not inverted, their scaling coefficients stay
+		   in the corner of data (see FullTransform::copy_lod) */
+		template<int WTYPE>
+		inline void iwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], const int lod = 0)
 		{
-			child.iwt(data, wtype);
+			child.template iwt<WTYPE>(data, lod - 1);
 			
-			this->template sweep3D<BS, false>(data, wtype);
+			if (lod <= 0)
+				this->template sweep3D<BS, false, ROT, WTYPE>(data);
 		}
 
+		/* one pass per detail row: vector compare, W mask bits at once, and the survivors
+		   are appended without branches (a store per coefficient, the count advances on the bit).
+		   the rows run along x of the coefficient frame: unless that is the memory row
+		   (COEFFROT == 0), they are gathered first */
 		template<typename DataType, int REFBS>
-		int threshold(const FwtAp eps, bitset<REFBS * REFBS * REFBS>& mask_survivors, DataType * const buffer_survivors, const FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
+		int threshold(const FwtAp eps, unsigned char * const mask, DataType * const buffer_survivors, const FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
 		{
-			enum { BSH = BS / 2 };
+			enum
+			{
+				BSH = BS / 2,
+				W = (int)FWT_SIMD_WIDTH < BSH ? (int)FWT_SIMD_WIDTH : BSH
+			};
 				
-			const int survivors = child.template threshold<DataType, REFBS>(eps, mask_survivors, buffer_survivors, data);
+			const int survivors = child.template threshold<DataType, REFBS>(eps, mask, buffer_survivors, data);
 			
 			DataType * const buffer_start = buffer_survivors + survivors;
 			int local_survivors = 0;
+			const FwtAp * const src = &data[0][0][0];
+			const int xstride = _rotated_offset<COEFFROT, ROWSIZE, COLSIZE>(0, 0, 1);
+
+			FwtAp row[BSH];
 
 			for(int code = 1; code < 8; ++code)
 			{
@@ -73,141 +163,445 @@ namespace WaveletsOnInterval
 				
 				for(int iz = 0; iz < BSH; ++iz)
 					for(int iy = 0; iy < BSH; ++iy)
-						for(int ix = 0; ix < BSH; ++ix)
+					{
+						const int ysrc = ystart + iy;
+						const int zsrc = zstart + iz;
+
+						const FwtAp * line = src + _rotated_offset<COEFFROT, ROWSIZE, COLSIZE>(zsrc, ysrc, xstart);
+
+						if (xstride != 1)
+						{
+							for(int ix = 0; ix < BSH; ++ix)
+								row[ix] = line[ix * xstride];
+
+							line = row;
+						}
+
+						const int rowbit = xstart + REFBS * (ysrc + REFBS * zsrc);
+
+						for(int ix = 0; ix < BSH; ix += W)
 						{
-							const int xsrc = xstart + ix;
-							const int ysrc = ystart + iy;
-							const int zsrc = zstart + iz;
-														
-							const FwtAp mydata = data[zsrc][ysrc][xsrc];
-							
-							const bool accepted = fabs(mydata) > eps; 
-							
-							const int dst = xsrc + REFBS * (ysrc + REFBS * zsrc);
-
-							mask_survivors[dst] = accepted;
-							
-							if (accepted)
-								buffer_start[local_survivors++] = (DataType)mydata;
+							const unsigned int accepted = _significant<W>(line + ix, eps);
+
+							_setbits<W>(mask, rowbit + ix, accepted);
+
+							for(int l = 0; l < W; ++l)
+							{
+								buffer_start[local_survivors] = (DataType)line[ix + l];
+								local_survivors += accepted >> l & 1;
+							}
 						}
+					}
 			}
 	
 			return survivors + local_survivors;			
 		}
 		
 		
-		template<typename DataType>
-		void load(vector<DataType>& datastream, bitset<BS * BS * BS> mask, FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
-		{			
-			static const int BSH = BS / 2;
-			
-			for(int code = 7; code >= 1; --code)
+		/* the inverse of threshold: the survivors are read forward, coarse levels first, and
+		   every coefficient of a row takes the next survivor or zero depending on its mask bit.
+		   returns the number of survivors read. the details of the lod finest levels are skipped,
+		   and so is the mask of the subbands without survivors: bit 8 * log2(BSH) + code of
+		   subbands is not set (as SignificanceMap::subband) */
+		template<typename DataType, int REFBS>
+		int load(const DataType * const stream, const unsigned char * const mask, FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], const int lod = 0,
+			 const unsigned long long subbands = ~0ull)
+		{
+			enum
+			{
+				BSH = BS / 2,
+				W = (int)FWT_SIMD_WIDTH < BSH ? (int)FWT_SIMD_WIDTH : BSH
+			};
+
+			const int survivors = child.template load<DataType, REFBS>(stream, mask, data, lod - 1, subbands);
+
+			if (lod > 0)
+				return survivors;
+
+			assert(survivors > 0);
+
+			const DataType * const stream_start = stream + survivors;
+			int local_survivors = 0;
+			FwtAp * const dst = &data[0][0][0];
+			const int xstride = _rotated_offset<COEFFROT, ROWSIZE, COLSIZE>(0, 0, 1);
+
+			for(int code = 1; code < 8; ++code)
 			{
 				const int xstart = BSH * (code & 1);
 				const int ystart = BSH * (code / 2 & 1);
 				const int zstart = BSH * (code / 4 & 1);
-				
-				for(int iz = BSH - 1; iz >= 0; --iz)
-					for(int iy = BSH - 1; iy >= 0; --iy)
-						for(int ix = BSH - 1; ix >= 0; --ix)
+
+				// LEVELS - 1 levels below this one: log2(BSH) = LEVELS
+				if (!(subbands >> (8 * LEVELS + code) & 1))
+				{
+					for(int iz = 0; iz < BSH; ++iz)
+						for(int iy = 0; iy < BSH; ++iy)
 						{
-							const int myx = xstart + ix;
-							const int myy = ystart + iy;
-							const int myz = zstart + iz;
-							
-							const int srcidx = myx + BS * (myy + BS * myz);
-							
-							assert(srcidx >= 0);
-							assert(srcidx < BS * BS * BS);
-							
-							const bool eat = mask[srcidx];
-							
-							const DataType mydata = eat ? datastream.back() : 0;
-							
-							data[myz][myy][myx] = mydata;
-							
-							if (eat) 
-								datastream.pop_back();						
+							FwtAp * const line = dst + _rotated_offset<COEFFROT, ROWSIZE, COLSIZE>(zstart + iz, ystart + iy, xstart);
+
+							for(int ix = 0; ix < BSH; ++ix)
+								line[ix * xstride] = 0;
 						}
-			}
-			
-			//code 0
-			{
-				bitset<BSH * BSH * BSH> childmask;
-				
+
+					continue;
+				}
+
 				for(int iz = 0; iz < BSH; ++iz)
 					for(int iy = 0; iy < BSH; ++iy)
-						for(int ix = 0; ix < BSH; ++ix)
+					{
+						const int ysrc = ystart + iy;
+						const int zsrc = zstart + iz;
+
+						FwtAp * const line = dst + _rotated_offset<COEFFROT, ROWSIZE, COLSIZE>(zsrc, ysrc, xstart);
+
+						const int rowbit = xstart + REFBS * (ysrc + REFBS * zsrc);
+
+						for(int ix = 0; ix < BSH; ix += W)
 						{
-							const int src = ix + BS * (iy + BS * iz);
-							const int dst = ix + BSH * (iy + BSH * iz);
-							
-							childmask[dst] = mask[src];
+							const unsigned int accepted = _getbits<W>(mask, rowbit + ix);
+
+							if (!accepted)
+							{
+								for(int l = 0; l < W; ++l)
+									line[(ix + l) * xstride] = 0;
+
+								continue;
+							}
+
+							// a coefficient not accepted reads the survivor before, never
+							// past the last one: there is one, the 4^3 level keeps them all
+							for(int l = 0; l < W; ++l)
+							{
+								const bool eat = accepted >> l & 1;
+								const FwtAp value = stream_start[local_survivors - !eat];
+
+								line[(ix + l) * xstride] = eat ? value : 0;
+								local_survivors += eat;
+							}
 						}
-				
-				child.load(datastream, childmask, data);
+					}
 			}
+
+			return survivors + local_survivors;
 		}
 	};
 	
-	template<int ROWSIZE, int COLSIZE, int SLICESIZE>
-	struct FullTransformEngine<4, ROWSIZE, COLSIZE, SLICESIZE>
+	template<int ROWSIZE, int COLSIZE, int SLICESIZE, int ROT>
+	struct FullTransformEngine<4, ROWSIZE, COLSIZE, SLICESIZE, ROT>
 	{
 		enum { BS = 4 } ;
+		enum { LEVELS = 1 };
 		
-		void fwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], int wtype) { }
+		template<int WTYPE>
+		void fwt(FwtAp [SLICESIZE][COLSIZE][ROWSIZE]) { }
 		
-		void iwt(FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], int wtype) { }
+		template<int WTYPE>
+		void iwt(FwtAp [SLICESIZE][COLSIZE][ROWSIZE], const int = 0) { }
 		
 		template<typename DataType, int REFBS>
-		int threshold(const FwtAp eps, bitset<REFBS * REFBS * REFBS>& mask_survivors, DataType * const buffer_survivors, const FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
+		int threshold(const FwtAp eps, unsigned char * const mask, DataType * const buffer_survivors, const FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
 		{	
+			const FwtAp * const src = &data[0][0][0];
+			
 			for(int iz = 0; iz < BS; ++iz)
 				for(int iy = 0; iy < BS; ++iy)
-					for(int ix = 0; ix < BS; ++ix)
-						mask_survivors[ix + REFBS * (iy + REFBS * iz)] = true;
+					_setbits<BS>(mask, REFBS * (iy + REFBS * iz), (1 << BS) - 1);
 			
 			for(int iz = 0, c = 0; iz < BS; ++iz)
 				for(int iy = 0; iy < BS; ++iy)
 					for(int ix = 0; ix < BS; ++ix, ++c)
-						buffer_survivors[c] = data[iz][iy][ix];
+						buffer_survivors[c] = src[_rotated_offset<ROT, ROWSIZE, COLSIZE>(iz, iy, ix)];
 			
 			return BS * BS * BS;
 		}
 		
-		template<typename DataType>
-		void load(vector<DataType>& datastream, bitset<BS * BS * BS> mask, FwtAp data[SLICESIZE][COLSIZE][ROWSIZE])
+		template<typename DataType, int REFBS>
+		int load(const DataType * const stream, const unsigned char * const, FwtAp data[SLICESIZE][COLSIZE][ROWSIZE], const int = 0,
+			 const unsigned long long = ~0ull)
 		{
-			assert(datastream.size() == BS * BS * BS);
+			FwtAp * const dst = &data[0][0][0];
 			
 			for(int iz = 0, c = 0; iz < BS; ++iz)
 				for(int iy = 0; iy < BS; ++iy)
 					for(int ix = 0; ix < BS; ++ix, ++c)
-						data[iz][iy][ix] = datastream[c];
+						dst[_rotated_offset<ROT, ROWSIZE, COLSIZE>(iz, iy, ix)] = stream[c];
 			
-			datastream.clear();
+			return BS * BS * BS;
 		}
 	};
 	
+	/* K blocks transformed together, one block per SIMD lane (structure of arrays across blocks).
+	   the levels and rotations are those of FullTransformEngine: lane k ends up with exactly the
+	   coefficients FullTransform computes for block k. every line is a full register, also at the
+	   coarsest levels, and no gather is needed */
+	template<int BS, int SIZE, int K, int ROT = 0>
+	struct BatchTransformEngine : WaveletSweep< ChosenWavelets, SIZE, SIZE>
+	{
+		typedef typename FwtLanes<K>::V V;
+		
+		BatchTransformEngine<BS/2, SIZE, K, (ROT + 1) % 3> child;
+		
+		template<bool forward, int AXIS, int WTYPE>
+		inline void sweep_batch(V data[SIZE][SIZE][SIZE])
+		{
+			enum
+			{
+				inplace = ChosenWavelets::template InPlace<WTYPE>::value,
+				STRIDE = AXIS == 2 ? 1 : AXIS == 1 ? SIZE : SIZE * SIZE
+			};
+			
+			for(int a = 0; a < BS; ++a)
+				for(int b = 0; b < BS; ++b)
+				{
+					V * const base = AXIS == 2 ? &data[a][b][0] : AXIS == 1 ? &data[a][0][b] : &data[0][a][b];
+					V lines[BS];
+					
+					for(int i = 0; i < BS; ++i)
+						lines[this->template _element<BS, inplace && !forward>(i)] = base[i * STRIDE];
+					
+					this->template _transform<BS, forward, WTYPE>(lines);
+					
+					for(int i = 0; i < BS; ++i)
+						base[i * STRIDE] = lines[this->template _element<BS, inplace && forward>(i)];
+				}
+		}
+		
+		template<int WTYPE>
+		inline void fwt(V data[SIZE][SIZE][SIZE])
+		{
+			sweep_batch<true, (2 + ROT) % 3, WTYPE>(data);
+			sweep_batch<true, (1 + ROT) % 3, WTYPE>(data);
+			sweep_batch<true, ROT % 3, WTYPE>(data);
+			
+			child.template fwt<WTYPE>(data);
+		}
+		
+		template<int WTYPE>
+		inline void iwt(V data[SIZE][SIZE][SIZE])
+		{
+			child.template iwt<WTYPE>(data);
+			
+			sweep_batch<false, ROT % 3, WTYPE>(data);
+			sweep_batch<false, (1 + ROT) % 3, WTYPE>(data);
+			sweep_batch<false, (2 + ROT) % 3, WTYPE>(data);
+		}
+	};
+	
+	template<int SIZE, int K, int ROT>
+	struct BatchTransformEngine<4, SIZE, K, ROT>
+	{
+		typedef typename FwtLanes<K>::V V;
+		
+		template<int WTYPE>
+		void fwt(V [SIZE][SIZE][SIZE]) { }
+		
+		template<int WTYPE>
+		void iwt(V [SIZE][SIZE][SIZE]) { }
+	};
+	
 	template<int BS>
 	struct FullTransform : FullTransformEngine<BS, BS, BS, BS>
 	{
 		FwtAp  data[BS][BS][BS];
 		
-		void fwt(int wtype)  { FullTransformEngine<BS, BS, BS, BS>::fwt(data, wtype); }
+		template<int WTYPE>
+		void fwt() { FullTransformEngine<BS, BS, BS, BS>::template fwt<WTYPE>(data); }
 		
-		void iwt(int wtype) { FullTransformEngine<BS, BS, BS, BS>::iwt(data, wtype); }
+		template<int WTYPE>
+		void iwt(const int lod = 0) { FullTransformEngine<BS, BS, BS, BS>::template iwt<WTYPE>(data, lod); }
+
+		/* the only runtime branch on the wavelet type: once per block */
+		void fwt(int wtype)
+		{
+			switch (wtype)
+			{
+				case 1: fwt<1>(); break;
+				case 2: fwt<2>(); break;
+				case 4: fwt<4>(); break;
+				case 5: fwt<5>(); break;
+				case 6: fwt<6>(); break;
+				default: fwt<3>(); break;	// wtype == 3 (and wtype == 0 for the moment)
+			}
+		}
+		
+		void iwt(int wtype, const int lod = 0)
+		{
+			switch (wtype)
+			{
+				case 1: iwt<1>(lod); break;
+				case 2: iwt<2>(lod); break;
+				case 4: iwt<4>(lod); break;
+				case 5: iwt<5>(lod); break;
+				case 6: iwt<6>(lod); break;
+				default: iwt<3>(lod); break;
+			}
+		}
 		
+		/* mask: the (BS^3 + 7) / 8 bytes of the significance map, zeroed by the caller */
 		template<typename DataType, int REFBS>
-		int threshold(const FwtAp eps, bitset<REFBS * REFBS * REFBS>& mask_survivors, DataType * const buffer_survivors)
+		int threshold(const FwtAp eps, unsigned char * const mask, DataType * const buffer_survivors)
 		{
-			return FullTransformEngine<BS, BS, BS, BS>::template threshold<DataType, BS>(eps, mask_survivors, buffer_survivors, data);
+			return FullTransformEngine<BS, BS, BS, BS>::template threshold<DataType, BS>(eps, mask, buffer_survivors, data);
 		}
 
+		/* stream: the survivors, mask: the significance map written by threshold, subbands: those
+		   with survivors, if known (see SignificanceMap::decode) */
 		template<typename DataType>
-		void load(vector<DataType>& datastream, bitset<BS * BS * BS> mask)
+		int load(const DataType * const stream, const unsigned char * const mask, const int lod = 0, const unsigned long long subbands = ~0ull)
 		{
-			FullTransformEngine<BS, BS, BS, BS>::template load<DataType>(datastream, mask, data);
+			return FullTransformEngine<BS, BS, BS, BS>::template load<DataType, BS>(stream, mask, data, lod, subbands);
+		}
+
+		/* levels of detail: 0 is the block itself, MAXLOD the 4^3 coarsest scaling coefficients */
+		enum { MAXLOD = FullTransformEngine<BS, BS, BS, BS>::LEVELS - 1 };
+
+		/* after iwt(wtype, lod): the (BS >> lod)^3 scaling coefficients of level lod, a downsampled
+		   block, sit in the corner of data. the rotations only reorder the directions of the
+		   sweeps and of the coefficient addressing, the corner is in the frame of data */
+		template<typename DataType>
+		void copy_lod(const int lod, DataType * const dst) const
+		{
+			assert(lod >= 0 && lod <= MAXLOD);
+
+			const int n = BS >> lod;
+
+			for(int iz = 0, c = 0; iz < n; ++iz)
+				for(int iy = 0; iy < n; ++iy)
+					for(int ix = 0; ix < n; ++ix, ++c)
+						dst[c] = data[iz][iy][ix];
+		}
+	};
+	
+	template<int BS, int BATCH = FWT_SIMD_WIDTH>
+	struct FullTransformBatch : BatchTransformEngine<BS, BS, BATCH>
+	{
+		enum { K = BATCH };
+		
+		typedef typename FwtLanes<K>::V V;
+		
+		V data[BS][BS][BS];
+		
+		/* the registers of data need their alignment, which new gives only from C++17 on */
+		static FullTransformBatch * create()
+		{
+			void * mem = NULL;
+			
+			if (posix_memalign(&mem, max(__alignof__(FullTransformBatch), sizeof(void *)), sizeof(FullTransformBatch)) != 0)
+			{
+				printf("FullTransformBatch: out of memory!!\n");
+				abort();
+			}
+			
+			return new (mem) FullTransformBatch;
+		}
+		
+		static void destroy(FullTransformBatch * const batch)
+		{
+			if (batch == NULL) return;
+			
+			batch->~FullTransformBatch();
+			free(batch);
+		}
+		
+		/* in-register transposition of K x K points: log2(K) stages, each swapping the
+		   off-diagonal h x h sub-blocks of the 2h x 2h diagonal blocks (h = K/2, ..., 1) */
+		template<int h>
+		static inline void _transpose(V r[K])
+		{
+			typedef typename FwtLanes<K>::M M;
+			
+			M lo, hi;
+			
+			for(int c = 0; c < K; ++c)
+			{
+				lo[c] = (c & h) ? K + c - h : c;
+				hi[c] = (c & h) ? K + c : c + h;
+			}
+			
+			for(int i = 0; i < K; ++i)
+				if (!(i & h))
+				{
+					const V a = r[i], b = r[i + h];
+					
+					r[i] = __builtin_shuffle(a, b, lo);
+					r[i + h] = __builtin_shuffle(a, b, hi);
+				}
+			
+			if (h > 1)
+				_transpose<(h > 1 ? h / 2 : 1)>(r);
+		}
+		
+		/* blocks src[0..n) -> lanes 0..n, K points of the K blocks at a time */
+		void pack(const FwtAp * const src[], const int n)
+		{
+			assert(n <= K);
+			
+			V * const d = &data[0][0][0];
+			
+			for(int i0 = 0; i0 < BS * BS * BS; i0 += K)
+			{
+				V r[K];
+				
+				for(int k = 0; k < K; ++k)
+					memcpy(&r[k], src[k < n ? k : 0] + i0, sizeof(V));
+				
+				_transpose<K / 2>(r);
+				
+				for(int t = 0; t < K; ++t)
+					d[i0 + t] = r[t];
+			}
+		}
+		
+		void unpack(FwtAp * const dst[], const int n) const
+		{
+			assert(n <= K);
+			
+			const V * const s = &data[0][0][0];
+			
+			for(int i0 = 0; i0 < BS * BS * BS; i0 += K)
+			{
+				V r[K];
+				
+				for(int t = 0; t < K; ++t)
+					r[t] = s[i0 + t];
+				
+				_transpose<K / 2>(r);
+				
+				for(int k = 0; k < n; ++k)
+					memcpy(dst[k] + i0, &r[k], sizeof(V));
+			}
+		}
+		
+		template<int WTYPE>
+		void fwt() { BatchTransformEngine<BS, BS, K>::template fwt<WTYPE>(data); }
+		
+		template<int WTYPE>
+		void iwt() { BatchTransformEngine<BS, BS, K>::template iwt<WTYPE>(data); }
+		
+		void fwt(int wtype)
+		{
+			switch (wtype)
+			{
+				case 1: fwt<1>(); break;
+				case 2: fwt<2>(); break;
+				case 4: fwt<4>(); break;
+				case 5: fwt<5>(); break;
+				case 6: fwt<6>(); break;
+				default: fwt<3>(); break;
+			}
+		}
+		
+		void iwt(int wtype)
+		{
+			switch (wtype)
+			{
+				case 1: iwt<1>(); break;
+				case 2: iwt<2>(); break;
+				case 4: iwt<4>(); break;
+				case 5: iwt<5>(); break;
+				case 6: iwt<6>(); break;
+				default: iwt<3>(); break;
+			}
 		}
 	};
 }
@@ -0,0 +1,286 @@
+/*
+ * HalfFloat.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _HALFFLOAT_H_
+#define _HALFFLOAT_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/* reduced-precision storage of the wavelet survivors ("HalfFloat:" in the header):
+   IEEE half, bfloat16 or, for double builds, float. the survivors are narrowed in place
+   once they are thresholded and widened in place, backwards, before they are loaded.
+   a block with a survivor out of the range of the format keeps its survivors as they are */
+namespace HalfFloat
+{
+	enum Format { none = 0, fp16 = 1, bf16 = 2, fp32 = 3 };
+
+	inline const char * name(const int format)
+	{
+		if (format == fp16) return "fp16";
+		if (format == bf16) return "bf16";
+		if (format == fp32) return "fp32";
+		return "no";
+	}
+
+	/* -1 if unknown */
+	inline int parse(const std::string s)
+	{
+		if (s == "no") return none;
+		if (s == "fp16") return fp16;
+		if (s == "bf16") return bf16;
+		if (s == "fp32") return fp32;
+		return -1;
+	}
+
+	/* the HalfFloat: entry of a file header. older files have "yes" or "no", and their
+	   survivors are full width either way */
+	inline int parse_header(const std::string s)
+	{
+		return s == "yes" ? none : parse(s);
+	}
+
+	/* bytes per survivor */
+	inline int size(const int format, const int sizeofreal)
+	{
+		if (format == fp16 || format == bf16) return 2;
+		if (format == fp32) return 4;
+		return sizeofreal;
+	}
+
+	/* none of the n values of data rounds to inf in format: their magnitude is below
+	   half an ulp past the largest finite value */
+	template<typename T>
+	bool fits(const T * const data, const int n, const int format)
+	{
+		if (size(format, sizeof(T)) == sizeof(T)) return true;
+
+		const int mantissa = format == fp16 ? 10 : format == bf16 ? 7 : 23;
+		const int maxexp = format == fp16 ? 15 : 127;
+		const double limit = ldexp(2. - ldexp(1., -mantissa - 1), maxexp);
+
+		T maxabs = 0;
+		for(int i = 0; i < n; ++i)
+			maxabs = std::max(maxabs, (T)fabs(data[i]));
+
+		return maxabs < limit;
+	}
+
+	/* round to nearest even, overflow to inf, denormals kept (F. Giesen's float_to_half_fast3_rtne) */
+	inline unsigned short float_to_half(const float f)
+	{
+		const unsigned int f32inf = 255u << 23, f16max = (127u + 16) << 23;
+		const unsigned int denorm_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+		unsigned int x;
+		memcpy(&x, &f, sizeof(x));
+
+		const unsigned int sign = x & 0x80000000u;
+		x ^= sign;
+
+		unsigned int o;
+
+		if (x >= f16max)
+			o = (x > f32inf) ? 0x7e00 : 0x7c00;
+		else if (x < (113u << 23))
+		{
+			float a, b;
+			memcpy(&a, &x, sizeof(a));
+			memcpy(&b, &denorm_magic, sizeof(b));
+			a += b;
+			memcpy(&o, &a, sizeof(o));
+			o -= denorm_magic;
+		}
+		else
+		{
+			const unsigned int mant_odd = (x >> 13) & 1;
+			x += ((15u - 127) << 23) + 0xfff;
+			x += mant_odd;
+			o = x >> 13;
+		}
+
+		return o | (sign >> 16);
+	}
+
+	inline float half_to_float(const unsigned short h)
+	{
+		const unsigned int shifted_exp = 0x7c00u << 13, magic = 113u << 23;
+
+		unsigned int o = (h & 0x7fffu) << 13;
+		const unsigned int exp = shifted_exp & o;
+		o += (127u - 15) << 23;
+
+		if (exp == shifted_exp)
+			o += (128u - 16) << 23;
+		else if (exp == 0)
+		{
+			o += 1u << 23;
+
+			float a, b;
+			memcpy(&a, &o, sizeof(a));
+			memcpy(&b, &magic, sizeof(b));
+			a -= b;
+			memcpy(&o, &a, sizeof(o));
+		}
+
+		o |= (h & 0x8000u) << 16;
+
+		float f;
+		memcpy(&f, &o, sizeof(f));
+		return f;
+	}
+
+	/* round to nearest even, nans stay quiet nans */
+	inline unsigned short float_to_bf16(const float f)
+	{
+		unsigned int x;
+		memcpy(&x, &f, sizeof(x));
+
+		if ((x & 0x7fffffffu) > 0x7f800000u)
+			return (x >> 16) | 0x40;
+
+		return (x + 0x7fffu + ((x >> 16) & 1)) >> 16;
+	}
+
+	inline float bf16_to_float(const unsigned short b)
+	{
+		const unsigned int x = (unsigned int)b << 16;
+
+		float f;
+		memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+
+	enum { CHUNK = 8 };
+
+	/* CHUNK values at once, through registers: src and dst may overlap */
+	template<typename T>
+	inline void _narrow_chunk(const T * const src, unsigned char * const dst, const int format)
+	{
+		float f[CHUNK];
+		for(int l = 0; l < CHUNK; ++l)
+			f[l] = src[l];
+
+		if (format == fp32)
+		{
+			memcpy(dst, f, sizeof(f));
+			return;
+		}
+
+		unsigned short h[CHUNK];
+
+		if (format == fp16)
+		{
+#if defined(__F16C__)
+			_mm_storeu_si128((__m128i *)h, _mm256_cvtps_ph(_mm256_loadu_ps(f), _MM_FROUND_TO_NEAREST_INT));
+#else
+			for(int l = 0; l < CHUNK; ++l)
+				h[l] = float_to_half(f[l]);
+#endif
+		}
+		else
+			for(int l = 0; l < CHUNK; ++l)
+				h[l] = float_to_bf16(f[l]);
+
+		memcpy(dst, h, sizeof(h));
+	}
+
+	template<typename T>
+	inline void _widen_chunk(const unsigned char * const src, T * const dst, const int format)
+	{
+		float f[CHUNK];
+
+		if (format == fp32)
+			memcpy(f, src, sizeof(f));
+		else
+		{
+			unsigned short h[CHUNK];
+			memcpy(h, src, sizeof(h));
+
+			if (format == fp16)
+			{
+#if defined(__F16C__)
+				_mm256_storeu_ps(f, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)h)));
+#else
+				for(int l = 0; l < CHUNK; ++l)
+					f[l] = half_to_float(h[l]);
+#endif
+			}
+			else
+				for(int l = 0; l < CHUNK; ++l)
+					f[l] = bf16_to_float(h[l]);
+		}
+
+		for(int l = 0; l < CHUNK; ++l)
+			dst[l] = f[l];
+	}
+
+	/* the n values of data are rewritten as size(format) bytes each, from the start of data.
+	   forward: a chunk is stored only after it is read, and never beyond it */
+	template<typename T>
+	void narrow(T * const data, const int n, const int format)
+	{
+		const int esize = size(format, sizeof(T));
+
+		if (esize == sizeof(T)) return;
+
+		unsigned char * const dst = (unsigned char *)data;
+
+		int i = 0;
+		for(; i + CHUNK <= n; i += CHUNK)
+			_narrow_chunk(data + i, dst + i * esize, format);
+
+		if (i < n)
+		{
+			T tail[CHUNK] = { 0 };
+			memcpy(tail, data + i, (n - i) * sizeof(T));
+
+			unsigned char out[CHUNK * sizeof(T)];
+			_narrow_chunk(tail, out, format);
+			memcpy(dst + i * esize, out, (n - i) * esize);
+		}
+	}
+
+	/* the inverse of narrow: backwards, so that no narrow value is overwritten before it is read */
+	template<typename T>
+	void widen(T * const data, const int n, const int format)
+	{
+		const int esize = size(format, sizeof(T));
+
+		if (esize == sizeof(T)) return;
+
+		const unsigned char * const src = (const unsigned char *)data;
+
+		const int nfull = n - n % CHUNK;
+
+		if (nfull < n)
+		{
+			unsigned char in[CHUNK * sizeof(T)] = { 0 };
+			memcpy(in, src + nfull * esize, (n - nfull) * esize);
+
+			T tail[CHUNK];
+			_widen_chunk(in, tail, format);
+			memcpy(data + nfull, tail, (n - nfull) * sizeof(T));
+		}
+
+		for(int i = nfull - CHUNK; i >= 0; i -= CHUNK)
+			_widen_chunk(src + i * esize, data + i, format);
+	}
+}
+
+#endif
@@ -0,0 +1,691 @@
+/*
+ * RansCoder.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _RANSCODER_H_
+#define _RANSCODER_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* table-driven order-0 rANS coder for the second stage ("Encoder: rans" in the header),
+   after F. Giesen's rans_byte: 32-bit states, byte-wise renormalization. the byte at
+   position i of a stream is coded with the state i % NSTATES and one of the models of
+   its lane i % K, K is 1, 4 or 8: the lanes of 4 or 8 follow the bytes of the floating
+   point values (the byte planes, without shuffling). with the zero context a lane has a
+   second model for the bytes whose byte NSTATES before is zero, that follows the long zero
+   runs of the masks. the choice is made per stream from the entropies:
+
+	[uint32 bytes][K | ZEROCONTEXT] [tables] [NSTATES uint32 states] [coded bytes]
+
+   a table is a 256-bit presence map followed by the frequencies - 1 of the present
+   symbols, 7 bits per byte. K = 0: the bytes are stored as they are.
+
+   the caller may give the regions of the stream that hold shuffled elements of esize bytes
+   (the survivors of the wavelets with a filter), each cut into esize byte planes of equal
+   length, the last one with the bytes left: the bytes of plane p of all the regions have
+   a model of their own, the lanes are for the other bytes. the regions come before the
+   tables, with PLANES set:
+
+	[esize] [number of regions] [(start - end of the region before, bytes) of each]
+
+   as varints of 7 bits per byte, and the esize plane models after the K * C lane models */
+namespace Rans
+{
+	enum
+	{
+		PROB_BITS = 14,
+		PROB_SCALE = 1 << PROB_BITS,
+		RANS_L = 1u << 23,
+		NSTATES = 4,
+		MAXLANES = 8,
+		MAXPLANES = 8,
+		MAXMODELS = 2 * MAXLANES + MAXPLANES,
+		ZEROCONTEXT = 0x80,
+		PLANES = 0x40,
+		OUTSIDE = 0xff,
+		PREAMBLE = sizeof(unsigned int) + 1
+	};
+
+	struct Model
+	{
+		unsigned int freq[256], cum[257];
+	};
+
+	/* bytes of in that hold shuffled elements */
+	struct Region
+	{
+		size_t start, bytes;
+	};
+
+	/* the regions of a stream and the bytes of their elements */
+	struct Planes
+	{
+		std::vector<Region> regions;
+		int esize;
+
+		Planes(): esize(0) { }
+	};
+
+	/* the encoder side of a symbol: the division by freq is a multiplication by its reciprocal */
+	struct EncSymbol
+	{
+		unsigned int x_max, rcp_freq, bias, cmpl_freq, rcp_shift;
+
+		void init(const unsigned int start, const unsigned int freq)
+		{
+			x_max = ((RANS_L >> PROB_BITS) << 8) * freq;
+			cmpl_freq = PROB_SCALE - freq;
+
+			if (freq < 2)
+			{
+				rcp_freq = ~0u;
+				rcp_shift = 0;
+				bias = start + PROB_SCALE - 1;
+			}
+			else
+			{
+				unsigned int shift = 0;
+				while (freq > (1u << shift)) shift++;
+
+				rcp_freq = (unsigned int)(((1ull << (shift + 31)) + freq - 1) / freq);
+				rcp_shift = shift - 1;
+				bias = start;
+			}
+		}
+	};
+
+	/* the byte counts scaled to PROB_SCALE, every present symbol keeps at least 1 */
+	inline void _normalize(const unsigned int count[256], const size_t n, Model& m)
+	{
+		int sum = 0;
+
+		for(int s = 0; s < 256; ++s)
+		{
+			m.freq[s] = count[s] ? std::max(1, (int)((double)count[s] * PROB_SCALE / n)) : 0;
+			sum += m.freq[s];
+		}
+
+		// the difference goes to, or comes from, the most frequent symbols
+		while (sum != PROB_SCALE)
+		{
+			int smax = 0;
+			for(int s = 1; s < 256; ++s)
+				if (m.freq[s] > m.freq[smax]) smax = s;
+
+			if (sum < PROB_SCALE)
+			{
+				m.freq[smax] += PROB_SCALE - sum;
+				sum = PROB_SCALE;
+			}
+			else
+			{
+				const int d = std::min(sum - PROB_SCALE, (int)m.freq[smax] - 1);
+				assert(d > 0);
+				m.freq[smax] -= d;
+				sum -= d;
+			}
+		}
+
+		m.cum[0] = 0;
+		for(int s = 0; s < 256; ++s)
+			m.cum[s + 1] = m.cum[s] + m.freq[s];
+	}
+
+	inline size_t _table_size(const Model& m)
+	{
+		size_t bytes = 32;
+
+		for(int s = 0; s < 256; ++s)
+			if (m.freq[s])
+				bytes += m.freq[s] > 0x80 ? 2 : 1;
+
+		return bytes;
+	}
+
+	inline size_t _write_table(const Model& m, unsigned char * const out)
+	{
+		unsigned char * ptr = out + 32;
+		memset(out, 0, 32);
+
+		for(int s = 0; s < 256; ++s)
+			if (m.freq[s])
+			{
+				out[s >> 3] |= 1 << (s & 7);
+
+				unsigned int f = m.freq[s] - 1;
+				for(; f >= 0x80; f >>= 7)
+					*ptr++ = 0x80 | (f & 0x7f);
+
+				*ptr++ = f;
+			}
+
+		return ptr - out;
+	}
+
+	/* a corrupt stream: a read past its end or a table that does not add up */
+	inline void _failure(const char * const what)
+	{
+		printf("RANS DECOMPRESSION FAILURE!! (%s)\n", what);
+		abort();
+	}
+
+	/* the table at ptr, not past end, into m. returns the position after it */
+	inline const unsigned char * _read_table(const unsigned char * ptr, const unsigned char * const end, Model& m)
+	{
+		if (end - ptr < 32) _failure("table past the end");
+
+		const unsigned char * const present = ptr;
+		ptr += 32;
+
+		unsigned int sum = 0;
+
+		for(int s = 0; s < 256; ++s)
+		{
+			m.freq[s] = 0;
+
+			if (present[s >> 3] >> (s & 7) & 1)
+			{
+				unsigned int f = 0;
+				for(int shift = 0; ; shift += 7)
+				{
+					if (ptr == end || shift > 7) _failure("bad table");
+
+					const unsigned int b = *ptr++;
+					f |= (b & 0x7f) << shift;
+					if (b < 0x80) break;
+				}
+
+				m.freq[s] = f + 1;
+				sum += f + 1;
+			}
+		}
+
+		if (sum != PROB_SCALE) _failure("bad table");
+
+		m.cum[0] = 0;
+		for(int s = 0; s < 256; ++s)
+			m.cum[s + 1] = m.cum[s] + m.freq[s];
+
+		return ptr;
+	}
+
+	/* bytes needed at most by compress */
+	inline size_t bound(const size_t n)
+	{
+		return PREAMBLE + n;
+	}
+
+	/* the context of byte i: the byte NSTATES before it, of the same state, is zero.
+	   the decoding of the states is not serialized by it */
+	inline int _zero(const unsigned char * const buf, const size_t i)
+	{
+		return i < NSTATES || buf[i - NSTATES] == 0;
+	}
+
+	/* the model of byte i, with k lanes and c contexts */
+	inline int _model(const unsigned char * const buf, const size_t i, const int k, const int c)
+	{
+		return (i & (k - 1)) * c + (c == 2 && _zero(buf, i));
+	}
+
+	/* as above, with the byte planes of the regions after the lane models */
+	inline int _model(const unsigned char * const buf, const unsigned char * const plane, const size_t i, const int k, const int c)
+	{
+		return plane && plane[i] != OUTSIDE ? k * c + plane[i] : _model(buf, i, k, c);
+	}
+
+	inline void _put(unsigned int& x, unsigned char *& ptr, const EncSymbol& e)
+	{
+		while (x >= e.x_max)
+		{
+			*--ptr = x & 0xff;
+			x >>= 8;
+		}
+
+		const unsigned int q = (unsigned int)(((unsigned long long)x * e.rcp_freq) >> 32) >> e.rcp_shift;
+		x += e.bias + q * e.cmpl_freq;
+	}
+
+	inline unsigned int _get(unsigned int& x, const unsigned char *& ptr, const unsigned char * const end, const unsigned char * const slot2sym, const Model& m)
+	{
+		const unsigned int slot = x & (PROB_SCALE - 1);
+		const unsigned int s = slot2sym[slot];
+
+		x = m.freq[s] * (x >> PROB_BITS) + slot - m.cum[s];
+
+		while (x < RANS_L)
+		{
+			if (ptr == end) _failure("coded bytes past the end");
+			x = x << 8 | *ptr++;
+		}
+
+		return s;
+	}
+
+	/* the counts of a model: the bytes of the lanes l = j (mod k) of count, in the zero
+	   context (z = 1), not in it (z = 0) or both (z = -1) */
+	inline size_t _gather(const unsigned int count[MAXLANES][2][256], const int k, const int j, const int z, unsigned int cnt[256])
+	{
+		memset(cnt, 0, 256 * sizeof(unsigned int));
+
+		for(int l = j; l < MAXLANES; l += k)
+			for(int c = 0; c < 2; ++c)
+				if (z < 0 || z == c)
+					for(int s = 0; s < 256; ++s)
+						cnt[s] += count[l][c][s];
+
+		size_t tot = 0;
+		for(int s = 0; s < 256; ++s)
+			tot += cnt[s];
+
+		return tot;
+	}
+
+	inline size_t _stored(const unsigned char * const in, const size_t n, unsigned char * const out)
+	{
+		out[sizeof(unsigned int)] = 0;
+		memcpy(out + PREAMBLE, in, n);
+		return PREAMBLE + n;
+	}
+
+	inline unsigned char * _put_varint(unsigned char * ptr, size_t v)
+	{
+		for(; v >= 0x80; v >>= 7)
+			*ptr++ = 0x80 | (v & 0x7f);
+
+		*ptr++ = v;
+		return ptr;
+	}
+
+	inline size_t _get_varint(const unsigned char *& ptr, const unsigned char * const end)
+	{
+		size_t v = 0;
+		for(int shift = 0; ; shift += 7)
+		{
+			if (ptr == end || shift > 56) _failure("regions past the end");
+
+			const size_t b = *ptr++;
+			v |= (b & 0x7f) << shift;
+			if (b < 0x80) return v;
+		}
+	}
+
+	/* the byte plane of each byte of n, OUTSIDE for those not in a region, in the scratch of
+	   the calling thread. NULL without regions */
+	inline const unsigned char * _planes(const Region * const regions, const int nregions, const int esize, const size_t n)
+	{
+		if (nregions == 0) return NULL;
+
+		static thread_local std::vector<unsigned char> plane;
+		plane.assign(n, OUTSIDE);
+
+		for(int r = 0; r < nregions; ++r)
+		{
+			const size_t elements = regions[r].bytes / esize;
+
+			for(int p = 0; p < esize; ++p)
+			{
+				const size_t first = regions[r].start + p * elements;
+				const size_t last = p == esize - 1 ? regions[r].start + regions[r].bytes : first + elements;
+				memset(&plane[first], p, last - first);
+			}
+		}
+
+		return &plane.front();
+	}
+
+	/* the tables of the encoder, of the calling thread */
+	struct Encoding
+	{
+		Model model[MAXMODELS];
+		EncSymbol esym[MAXMODELS][256];
+	};
+
+	/* the tables of the decoder, of the calling thread: the symbols of a model are set again
+	   only when its frequencies change from the stream before */
+	struct Decoding
+	{
+		Model model[MAXMODELS];
+		std::vector<unsigned char> slot2sym;
+
+		Decoding() { memset(model, 0, sizeof(model)); }
+	};
+
+	/* n bytes of in into out (at least bound(n) bytes, not overlapping in). the regions,
+	   sorted and not overlapping, hold elements of esize bytes (at most MAXPLANES), shuffled.
+	   returns the bytes of out */
+	inline size_t compress(const unsigned char * const in, const size_t n, unsigned char * const out,
+			       const Region * const regions = NULL, const int nregions = 0, const int esize = 0)
+	{
+		const unsigned int n32 = n;
+		memcpy(out, &n32, sizeof(unsigned int));
+
+		if (n < 64) return _stored(in, n, out);
+
+		assert(nregions == 0 || (esize > 0 && esize <= MAXPLANES));
+		const unsigned char * const plane = _planes(regions, nregions, esize, n);
+		const int P = plane ? esize : 0;
+
+		unsigned int count[MAXLANES][2][256], pcount[MAXPLANES][256];
+		memset(count, 0, sizeof(count));
+		memset(pcount, 0, sizeof(pcount));
+
+		size_t outside = n;
+
+		if (plane)
+		{
+			outside = 0;
+
+			for(size_t i = 0; i < n; ++i)
+				if (plane[i] == OUTSIDE)
+				{
+					++count[i & (MAXLANES - 1)][_zero(in, i)][in[i]];
+					++outside;
+				}
+				else
+					++pcount[plane[i]][in[i]];
+		}
+		else
+			for(size_t i = 0; i < n; ++i)
+				++count[i & (MAXLANES - 1)][_zero(in, i)][in[i]];
+
+		// 1, 4 or 8 lanes, with or without the zero context: the smallest entropy, tables included
+		int K = 0, C = 1;
+		double best = outside;
+
+		for(int k = 1; k <= MAXLANES; k *= 2)
+			for(int c = 1; c <= 2; ++c)
+			{
+				if (k == 2) continue;
+
+				double bits = 0;
+
+				for(int j = 0; j < k; ++j)
+					for(int z = 0; z < c; ++z)
+					{
+						unsigned int cnt[256];
+						const size_t tot = _gather(count, k, j, c == 2 ? z : -1, cnt);
+
+						if (!tot) continue;
+
+						for(int s = 0; s < 256; ++s)
+							if (cnt[s]) bits += cnt[s] * (std::log2((double)tot) - std::log2((double)cnt[s])) + 10;
+
+						bits += 256;
+					}
+
+				const double bytes = bits / 8 + NSTATES * sizeof(unsigned int);
+
+				if (bytes < best)
+				{
+					best = bytes;
+					K = k;
+					C = c;
+				}
+			}
+
+		// the planes are coded anyway: the other bytes need a model too
+		if (K == 0 && !plane) return _stored(in, n, out);
+		if (K == 0) K = 1;
+
+		static thread_local Encoding tables;
+		Model * const model = tables.model;
+
+		unsigned char * ptr = out + PREAMBLE;
+
+		if (plane)
+		{
+			*ptr++ = esize;
+			ptr = _put_varint(ptr, nregions);
+
+			size_t end = 0;
+			for(int r = 0; r < nregions; end = regions[r].start + regions[r].bytes, ++r)
+			{
+				ptr = _put_varint(ptr, regions[r].start - end);
+				ptr = _put_varint(ptr, regions[r].bytes);
+			}
+		}
+
+		size_t head = ptr - out + NSTATES * sizeof(unsigned int);
+
+		for(int m = 0; m < K * C + P; ++m)
+		{
+			unsigned int cnt[256];
+			size_t tot = 0;
+
+			if (m < K * C)
+				tot = _gather(count, K, m / C, C == 2 ? m % C : -1, cnt);
+			else
+				for(int s = 0; s < 256; ++s)
+					tot += (cnt[s] = pcount[m - K * C][s]);
+
+			if (tot == 0) cnt[0] = tot = 1;	// an unused model still needs a valid table
+
+			_normalize(cnt, tot, model[m]);
+			head += _table_size(model[m]);
+		}
+
+		if (head + 8 >= bound(n)) return _stored(in, n, out);
+
+		out[sizeof(unsigned int)] = K | (C == 2 ? ZEROCONTEXT : 0) | (plane ? PLANES : 0);
+
+		for(int m = 0; m < K * C + P; ++m)
+		{
+			ptr += _write_table(model[m], ptr);
+
+			for(int s = 0; s < 256; ++s)
+				tables.esym[m][s].init(model[m].cum[s], model[m].freq[s]);
+		}
+
+		unsigned char * const states = ptr;
+		assert(states - out + NSTATES * sizeof(unsigned int) == head);
+
+		// the bytes are coded backwards, from the end of the output: the decoder reads them forward
+		const EncSymbol (* const esym)[256] = tables.esym;
+		unsigned char * const end = out + bound(n);
+		ptr = end;
+
+		unsigned int x[NSTATES];
+		for(int l = 0; l < NSTATES; ++l)
+			x[l] = RANS_L;
+
+		const size_t ngroups = n / NSTATES;
+
+		for(size_t i = n; i-- > ngroups * NSTATES; )
+			_put(x[i & (NSTATES - 1)], ptr, esym[_model(in, plane, i, K, C)][in[i]]);
+
+		// NSTATES bytes at a time, the states in registers
+		unsigned int x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+
+		for(size_t g = ngroups; g-- > 0; )
+		{
+			const size_t i = g * NSTATES;
+
+			_put(x3, ptr, esym[_model(in, plane, i + 3, K, C)][in[i + 3]]);
+			_put(x2, ptr, esym[_model(in, plane, i + 2, K, C)][in[i + 2]]);
+			_put(x1, ptr, esym[_model(in, plane, i + 1, K, C)][in[i + 1]]);
+			_put(x0, ptr, esym[_model(in, plane, i, K, C)][in[i]]);
+
+			// no gain (a renormalization writes at most 2 bytes): stored as it is
+			if (ptr < out + head + 2 * NSTATES + 8) return _stored(in, n, out);
+		}
+
+		x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3;
+
+		memcpy(states, x, sizeof(x));
+
+		const size_t nbytes = end - ptr;
+		memmove(out + head, ptr, nbytes);
+
+		return head + nbytes;
+	}
+
+	/* the bytes of out with K lanes, C contexts and the byte planes if P: K, C and P are
+	   constants of the loop, the model of a byte takes no call to _model */
+	template<int K, int C, bool P>
+	inline void _decode(unsigned int x[NSTATES], const unsigned char *& ptr, const unsigned char * const end,
+			    const unsigned char * const slot2sym, const Model * const model, const unsigned char * const plane,
+			    unsigned char * const out, const size_t n)
+	{
+		const size_t ngroups = n / NSTATES;
+
+		unsigned int x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+
+		for(size_t g = 0; g < ngroups; ++g)
+		{
+			const size_t i = g * NSTATES;
+			const int m0 = P ? _model(out, plane, i, K, C) : _model(out, i, K, C);
+			const int m1 = P ? _model(out, plane, i + 1, K, C) : _model(out, i + 1, K, C);
+			const int m2 = P ? _model(out, plane, i + 2, K, C) : _model(out, i + 2, K, C);
+			const int m3 = P ? _model(out, plane, i + 3, K, C) : _model(out, i + 3, K, C);
+
+			out[i] = _get(x0, ptr, end, slot2sym + m0 * PROB_SCALE, model[m0]);
+			out[i + 1] = _get(x1, ptr, end, slot2sym + m1 * PROB_SCALE, model[m1]);
+			out[i + 2] = _get(x2, ptr, end, slot2sym + m2 * PROB_SCALE, model[m2]);
+			out[i + 3] = _get(x3, ptr, end, slot2sym + m3 * PROB_SCALE, model[m3]);
+		}
+
+		x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3;
+
+		for(size_t i = ngroups * NSTATES; i < n; ++i)
+		{
+			const int m = P ? _model(out, plane, i, K, C) : _model(out, i, K, C);
+			out[i] = _get(x[i & (NSTATES - 1)], ptr, end, slot2sym + m * PROB_SCALE, model[m]);
+		}
+	}
+
+	template<int K, int C>
+	inline void _decode(unsigned int x[NSTATES], const unsigned char *& ptr, const unsigned char * const end,
+			    const unsigned char * const slot2sym, const Model * const model, const unsigned char * const plane,
+			    unsigned char * const out, const size_t n)
+	{
+		if (plane)
+			_decode<K, C, true>(x, ptr, end, slot2sym, model, plane, out, n);
+		else
+			_decode<K, C, false>(x, ptr, end, slot2sym, model, plane, out, n);
+	}
+
+	/* the ninputbytes bytes of in (from compress) into out, at most maxsize. returns their
+	   number. a stream that reads past ninputbytes aborts */
+	inline size_t decompress(const unsigned char * const in, const size_t ninputbytes, unsigned char * const out, const size_t maxsize)
+	{
+		if (ninputbytes < PREAMBLE) _failure("no preamble");
+
+		const unsigned char * const end = in + ninputbytes;
+
+		unsigned int n;
+		memcpy(&n, in, sizeof(unsigned int));
+
+		if (n > maxsize)
+		{
+			printf("RANS DECOMPRESSION FAILURE!! (%u bytes, room for %ld)\n", n, (long)maxsize);
+			abort();
+		}
+
+		const int K = in[sizeof(unsigned int)] & (MAXLANES | (MAXLANES - 1));
+		const int C = in[sizeof(unsigned int)] & ZEROCONTEXT ? 2 : 1;
+
+		if (K == 0)
+		{
+			if (n > ninputbytes - PREAMBLE) _failure("stored bytes past the end");
+
+			memcpy(out, in + PREAMBLE, n);
+			return n;
+		}
+
+		if (K != 1 && K != 4 && K != MAXLANES) _failure("bad lanes");
+
+		const unsigned char * ptr = in + PREAMBLE;
+
+		const unsigned char * plane = NULL;
+		int P = 0;
+
+		if (in[sizeof(unsigned int)] & PLANES)
+		{
+			if (ptr == end) _failure("regions past the end");
+
+			P = *ptr++;
+			const size_t nregions = _get_varint(ptr, end);
+
+			// two varints per region at least
+			if (P < 1 || P > MAXPLANES || nregions > (size_t)(end - ptr) / 2) _failure("bad regions");
+
+			static thread_local std::vector<Region> regions;
+			regions.resize(nregions);
+
+			size_t last = 0;
+			for(size_t r = 0; r < nregions; last = regions[r].start + regions[r].bytes, ++r)
+			{
+				const size_t gap = _get_varint(ptr, end);
+				const size_t bytes = _get_varint(ptr, end);
+
+				if (gap > n - last || bytes > n - last - gap)
+				{
+					printf("RANS DECOMPRESSION FAILURE!! (bad region %ld)\n", (long)r);
+					abort();
+				}
+
+				regions[r].start = last + gap;
+				regions[r].bytes = bytes;
+			}
+
+			plane = _planes(nregions ? &regions.front() : NULL, (int)nregions, P, n);
+		}
+
+		static thread_local Decoding tables;
+		Model * const model = tables.model;
+
+		if (tables.slot2sym.size() < (size_t)(K * C + P) * PROB_SCALE)
+			tables.slot2sym.resize((K * C + P) * PROB_SCALE);
+
+		for(int m = 0; m < K * C + P; ++m)
+		{
+			Model next;
+			ptr = _read_table(ptr, end, next);
+
+			if (!memcmp(next.freq, model[m].freq, sizeof(next.freq)))
+				continue;
+
+			model[m] = next;
+
+			unsigned char * const slot2sym = &tables.slot2sym[m * PROB_SCALE];
+			for(int s = 0; s < 256; ++s)
+				memset(slot2sym + model[m].cum[s], s, model[m].freq[s]);
+		}
+
+		const unsigned char * const slot2sym = &tables.slot2sym.front();
+
+		unsigned int x[NSTATES];
+		if ((size_t)(end - ptr) < sizeof(x)) _failure("states past the end");
+		memcpy(x, ptr, sizeof(x));
+		ptr += sizeof(x);
+
+		switch (K * 2 + C - 1)
+		{
+		case 2 * 1: _decode<1, 1>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		case 2 * 1 + 1: _decode<1, 2>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		case 2 * 4: _decode<4, 1>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		case 2 * 4 + 1: _decode<4, 2>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		case 2 * MAXLANES: _decode<MAXLANES, 1>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		case 2 * MAXLANES + 1: _decode<MAXLANES, 2>(x, ptr, end, slot2sym, model, plane, out, n); break;
+		}
+
+		return n;
+	}
+}
+
+#endif
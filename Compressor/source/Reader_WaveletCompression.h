@@ -37,6 +37,8 @@ typedef double Real;
 
 #include "../../Compressor/source/WaveletSerializationTypes.h"
 #include "../../Compressor/source/CompressionEncoders.h"
+#include "../../Compressor/source/BlockCodecs.h"
+#include "../../Compressor/source/Container.h"
 #include "../../Compressor/source/FullWaveletTransform.h"
 
 //MACRO TAKEN FROM http://stackoverflow.com/questions/3767869/adding-message-to-assert
@@ -110,8 +112,34 @@ protected:
 	int miniheader_bytes;
 	int NBLOCKS;
 	int totalbpd[3], bpd[3];
-	bool halffloat;
+	int halffloat;	// HalfFloat::Format
+	int sigmap;	// SignificanceMap::Format
+	int quantizer;	// BitPlane::Format
+	int maxplanes;	// bit planes decoded at most, with quantizer
+	int shuffle;	// Shuffle::Format
+	int encoder;	// Encoder::Format
+	int codec;	// BlockCodecs::Kind, from the "Wavelets:" entry
 	float threshold;	// peh: new
+	int channels;	// of each block, one after the other in its chunk
+	int channel;	// the one that is read
+	int step;	// of the record read in a container, -1 for a file of its own
+	string field;	// of the record
+
+	/* the last decompressed chunks: the channels of a block, and the blocks of a chunk,
+	   are read with one seek. not used when swapping, it happens in place */
+	enum { CHUNKCACHE = WaveletsOnInterval::FullTransformBatch<_BLOCKSIZE_>::K };
+
+	struct CachedChunk { size_t start, bytes; float zratio; unsigned char * buf; };
+
+	CachedChunk chunkcache[CHUNKCACHE];
+	int chunknext;	// slot of the next chunk
+
+	BlockCodec * blockcodec;	// created at the first block
+
+	typedef WaveletsOnInterval::FullTransformBatch<_BLOCKSIZE_> TransformBatch;
+
+	TransformBatch * batch;	// of load_blocks2, created at its first call
+	vector<Real> batchcoefficients;
 
 	vector<CompressedBlock> idx2chunk;
 
@@ -129,6 +157,24 @@ protected:
 		return ix + totalbpd[0] * ( iy + totalbpd[1] * iz );
 	}
 
+	/* the entry of the chunk with the stream of the block, for the channel read */
+	int _entry(const CompressedBlock& compressedchunk) const
+	{
+		return compressedchunk.subid * channels + channel;
+	}
+
+	/* the survivors of the wavelet stream buf in the byte order of this machine: they follow
+	   the significance map, the octree is parsed to know where */
+	void _swap_survivors(unsigned char * const buf, const int nbytes)
+	{
+		if (!doswapping) return;
+
+		const int esize = WaveletCompressor::survivors_esize(buf, nbytes, sigmap, halffloat);
+
+		for(int i = WaveletCompressor::survivors_offset(buf, sigmap); i + esize <= nbytes; i += esize)
+			swapbytes(buf + i, esize);
+	}
+
 	// peh: BGQ <-> x86_64
 	void swapbytes(unsigned char *mem, int nbytes)
 	{
@@ -234,12 +280,54 @@ protected:
 
 public:
 
-	Reader_WaveletCompression(const string path, bool doswapping, int wtype): path(path), doswapping(doswapping), wtype(wtype), global_header_displacement(-1), NBLOCKS(-1){ }
+	Reader_WaveletCompression(const string path, bool doswapping, int wtype): path(path), doswapping(doswapping), wtype(wtype), global_header_displacement(-1), NBLOCKS(-1), maxplanes(BitPlane::MAXPLANES),
+	channels(1), channel(0), step(-1), chunknext(0), blockcodec(NULL), batch(NULL)
+	{
+		for(int i = 0; i < CHUNKCACHE; ++i)
+		{
+			CachedChunk empty = { (size_t)-1, 0, 0, NULL };
+			chunkcache[i] = empty;
+		}
+	}
+
+	// progressive precision: quantized survivors are decoded from their first maxplanes bit planes
+	void set_maxplanes(const int maxplanes)
+	{
+		MYASSERT(maxplanes >= 1 && maxplanes <= BitPlane::MAXPLANES, "\nATTENZIONE:\nBit planes " << maxplanes << " not in [1, " << (int)BitPlane::MAXPLANES << "]\n");
+
+		this->maxplanes = maxplanes;
+
+		delete blockcodec;
+		blockcodec = NULL;
+	}
+
+	// the channel of the blocks read, in the files of several channels
+	void set_channel(const int channel)
+	{
+		MYASSERT(channel >= 0 && channel < channels, "\nATTENZIONE:\nChannel " << channel << " and the file has " << channels << "\n");
+
+		this->channel = channel;
+	}
+
+	int nchannels() const { return channels; }
+
+	// the record of step and field is read, in a container (see Container.h)
+	void set_record(const int step, const string field)
+	{
+		this->step = step;
+		this->field = field;
+	}
 
 	~Reader_WaveletCompression()
 	{
 		if (data != NULL) free(data);
 		data = NULL;
+
+		for(int i = 0; i < CHUNKCACHE; ++i)
+			free(chunkcache[i].buf);
+
+		delete blockcodec;
+		TransformBatch::destroy(batch);
 	}
 
 	void print_times()
@@ -273,14 +361,29 @@ public:
 
 			MYASSERT(file, "\nAAATTENZIONE:\nOooops could not open the file. Path: " << path);
 
+			//the record of step and field, the offsets in it are relative to its start
+			size_t record = 0;
+			if (step >= 0)
+			{
+				Container::Index index;
+				const bool container = Container::read(path, index);
+				MYASSERT(container, "\nATTENZIONE:\n" << path << " is not a container\n");
+
+				const Container::Entry * const entry = Container::find(index.entries, step, field);
+				MYASSERT(entry, "\nATTENZIONE:\nNo step " << step << " of field " << field << " in the container " << path << "\n");
+
+				record = entry->offset;
+				fseek(file, record, SEEK_SET);
+			}
+
 			//reading the header and mini header
 			{
 				size_t header_displacement = -1;
 				fread(&header_displacement, sizeof(size_t), 1, file);
 				header_displacement = swaplong(header_displacement);
 
-				fseek(file, header_displacement, SEEK_SET);
-				global_header_displacement = header_displacement;
+				fseek(file, record + header_displacement, SEEK_SET);
+				global_header_displacement = record + header_displacement;
 
 				char buf[1024];
 				fgets(buf, sizeof(buf), file);
@@ -353,52 +456,71 @@ public:
 
 				fscanf(file, "HalfFloat: %s\n", buf);
 				printf("HalfFloat: <%s>\n", buf);
-				this->halffloat = (string(buf) == "yes");
+				this->halffloat = HalfFloat::parse_header(buf);
+
+				MYASSERT(this->halffloat >= 0, "\nATTENZIONE:\nHalfFloat in the file is " << buf << "\n");
 
 				fscanf(file, "Wavelets: %s\n", buf);
 				printf("Wavelets: <%s>\n", buf);
-#if defined(_USE_WAVZ_)
-				MYASSERT(buf == string(WaveletsOnInterval::ChosenWavelets_GetName(wtype)),
-						"\nATTENZIONE:\nWavelets in the file is " << buf <<
-						" and i have " << WaveletsOnInterval::ChosenWavelets_GetName(wtype) << "\n");
-#elif defined(_USE_FPZIP_)
-				MYASSERT(buf == string("fpzip"),
-						"\nATTENZIONE:\nWavelets in the file is " << buf <<
-						" and i have " << "fpzip"  << "\n");
-#elif defined(_USE_ZFP_)
-				MYASSERT(buf == string("zfp"),
-						"\nATTENZIONE:\nWavelets in the file is " << buf <<
-						" and i have " << "zfp"  << "\n");
-#elif defined(_USE_SZ_)
-				MYASSERT(buf == string("sz"),
-						"\nATTENZIONE:\nWavelets in the file is " << buf <<
-						" and i have " << "sz"  << "\n");
-#else
-				MYASSERT(buf == string("none"),
+				this->codec = BlockCodecs::parse(buf, this->wtype);	// the wavelets of the file, whatever the wtype given
+
+				MYASSERT(BlockCodecs::available(this->codec),
 						"\nATTENZIONE:\nWavelets in the file is " << buf <<
-						" and i have " << "none"  << "\n");
-#endif
+						" and i do not have it (fpzip, zfp and sz need a build with them)\n");
 
 				float mythreshold = -1;
 				fscanf(file, "WaveletThreshold: %f\n", &mythreshold);
 				printf("WaveletThreshold: <%f>\n", mythreshold);
 				this->threshold = mythreshold;
 
+				// optional, older files have bitset masks
+				this->sigmap = SignificanceMap::bitset;
+				if (fscanf(file, "SignificanceMap: %s\n", buf) == 1)
+				{
+					printf("SignificanceMap: <%s>\n", buf);
+					this->sigmap = SignificanceMap::parse(buf);
+				}
+
+				MYASSERT(this->sigmap >= 0, "\nATTENZIONE:\nSignificanceMap in the file is " << buf << "\n");
+
+				this->quantizer = BitPlane::none;
+				if (fscanf(file, "Quantization: %s\n", buf) == 1)
+				{
+					printf("Quantization: <%s>\n", buf);
+					this->quantizer = BitPlane::parse(buf);
+				}
+
+				MYASSERT(this->quantizer >= 0, "\nATTENZIONE:\nQuantization in the file is " << buf << "\n");
+
+				// optional, older files have the shuffle of the build
+				this->shuffle = Shuffle::DEFAULT;
+				if (fscanf(file, "Filter: %s\n", buf) == 1)
+				{
+					printf("Filter: <%s>\n", buf);
+					this->shuffle = Shuffle::parse(buf);
+				}
+
+				MYASSERT(this->shuffle >= 0, "\nATTENZIONE:\nFilter in the file is " << buf << "\n");
+
+				// optional, the files of one channel do not have it
+				this->channels = 1;
+				if (fscanf(file, "Channels: %d\n", &this->channels) == 1)
+					printf("Channels: <%d>\n", this->channels);
+
+				MYASSERT(this->channels >= 1, "\nATTENZIONE:\nChannels in the file is " << this->channels << "\n");
+				this->channel = 0;
+
 				fscanf(file, "Encoder: %s\n", buf);
 				printf("Encoder: <%s>\n", buf);
-#if defined(_USE_ZLIB_)
-				MYASSERT(buf == string("zlib"),
-						 "\nATTENZIONE:\nEncoder in the file is " << buf <<
-						 " and i have zlib.\n");
-#elif defined(_USE_LZ4_)
-				MYASSERT(buf == string("lz4"),
-						 "\nATTENZIONE:\nEncoder in the file is " << buf <<
-						 " and i have lz4.\n");
-#else
-				MYASSERT(buf == string("none"),
+				this->encoder = Encoder::parse(buf);
+
+				MYASSERT(Encoder::available(this->encoder),
 						 "\nATTENZIONE:\nEncoder in the file is " << buf <<
-						 " and i have none.\n");
-#endif
+						 " and i do not have it (lz4 needs a build with lz4=1).\n");
+
+				// the survivors of the wavelets are swapped as they are, not quantized or filtered
+				MYASSERT(!doswapping || (this->codec == BlockCodecs::wavz && this->quantizer == BitPlane::none && this->shuffle == Shuffle::none),
+						 "\nATTENZIONE:\nSwapping reads only the wavelets with no -quantize and no -shuffle.\n");
 
 				fgets(buf, sizeof(buf), file);
 
@@ -436,7 +558,7 @@ public:
 
 				//bool done = false;
 
-				size_t base = miniheader_bytes;
+				size_t base = record + miniheader_bytes;
 
 				const int BPS = bpd[0] * bpd[1] * bpd[2];
 				assert(NBLOCKS % BPS == 0);
@@ -449,19 +571,6 @@ public:
 				for (int h = 0; h < SUBDOMAINS; h++) swapHL(hl[h]);
 				}
 
-				{
-					int c = fgetc(file);
-
-					do
-					{
-						// printf("shouldnt be here! 0x%x\n", c);
-						//abort();
-						c = fgetc(file);
-					}
-					while (! feof(file) );
-				}
-				//assert(feof(file));
-
 				for(int s = 0, currblock = 0; s < SUBDOMAINS; ++s)
 				{
 					const int nglobalchunks = lutchunks.size();
@@ -563,6 +672,34 @@ public:
 	int yblocks() { return totalbpd[1]; }
 	int zblocks() { return totalbpd[2]; }
 
+	/* the codec of the file */
+	BlockCodec& _codec()
+	{
+		if (blockcodec == NULL)
+		{
+			BlockCodecs::Settings settings(codec);
+			settings.threshold = threshold;
+			settings.wtype = wtype;
+			settings.halffloat = halffloat;
+			settings.sigmap = sigmap;
+			settings.quantizer = quantizer;
+			settings.shuffle = shuffle;
+			settings.maxplanes = maxplanes;
+
+			blockcodec = BlockCodecs::create(settings);
+		}
+
+		return *blockcodec;
+	}
+
+	/* the wavelet compressor of the codec, for the batched transforms and the levels of detail */
+	WaveletCompressor& _wavelets()
+	{
+		assert(codec == BlockCodecs::wavz);
+
+		return ((BlockCodecs::Wavelets&)_codec()).get_compressor();
+	}
+
 	/*
 	 * Obsolete function
 	 */
@@ -586,11 +723,11 @@ public:
 
 		assert(!feof(f));
 
-		static vector<unsigned char> waveletbuf(2 << 22); // 21: 4MB, 22: 8MB, 28: 512MB
-		const size_t decompressedbytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size());
+		static vector<unsigned char> waveletbuf(max(2 << 22, (int)sizeof(WaveletCompressor) + (int)sizeof(int))); // 8MB, or one block for large _BLOCKSIZE_
+		const size_t decompressedbytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size(), encoder);
 
 		int readbytes = 0;
-		for(int i = 0; i<compressedchunk.subid; ++i)
+		for(int i = 0; i<_entry(compressedchunk); ++i)
 		{
 			int nbytes = * (int *) & waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
@@ -606,42 +743,35 @@ public:
 			readbytes += sizeof(int);
 			assert(readbytes <= decompressedbytes);
 			//printf("decompressing %d bytes...\n", nbytes);
-			WaveletCompressor compressor;
 
-			{ // swapping
-			enum
-			{
-				BS3 = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_,
-				BITSETSIZE = (BS3 + 7) / 8
-			};
-
-			unsigned char *buf = & waveletbuf[readbytes];
-			for (int i = BITSETSIZE; i < nbytes; i+=4)
-				swapbytes(buf+i, 4);
-			}
+			_swap_survivors(&waveletbuf[readbytes], nbytes);
 
-			memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
+			_codec().decompress(&waveletbuf[readbytes], nbytes, &MYBLOCK[0][0][0]);
 			readbytes += nbytes;
-
-			compressor.decompress(halffloat, nbytes, wtype, MYBLOCK);
 		}
 
 		fclose(f);
 	}
 
-	/*
-	 * Returns a decompressed cubism block into MYBLOCK 
-	 */
-	float load_block2(int ix, int iy, int iz, Real MYBLOCK[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_])
+	/* the decompressed chunk, from the cache or read from the file */
+	const CachedChunk& _fetch_chunk(const CompressedBlock& compressedchunk)
 	{
-		float zratio1, zratio2;
+		if (!doswapping)
+			for(int i = 0; i < CHUNKCACHE; ++i)
+				if (chunkcache[i].start == compressedchunk.start)
+					return chunkcache[i];
+
+		CachedChunk& slot = chunkcache[chunknext];
+		chunknext = (chunknext + 1) % CHUNKCACHE;
+
+		const size_t bufsize = max(2 << 22, (int)sizeof(WaveletCompressor) + (int)sizeof(int)); // 8MB, or one block for large _BLOCKSIZE_
+		if (slot.buf == NULL)
+			slot.buf = (unsigned char *)malloc(bufsize);
 
 		FILE * f = fopen(path.c_str(), "rb");
 
 		assert(f);
 
-		CompressedBlock compressedchunk = idx2chunk[_id(ix, iy, iz)];
-
 		size_t start = compressedchunk.start;
 
 		assert(start >= miniheader_bytes);
@@ -654,15 +784,34 @@ public:
 
 		assert(!feof(f));
 
+		fclose(f);
+
 		size_t zz_bytes = compressedbuf.size();
-		static vector<unsigned char> waveletbuf(2 << 22); // 21: 4MB, 22: 8MB, 28: 512MB
-		const size_t decompressedbytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size());
-		zratio1 = (1.0*decompressedbytes)/zz_bytes;
+		slot.bytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), slot.buf, bufsize, encoder);
+		slot.zratio = (1.0*slot.bytes)/zz_bytes;
+		slot.start = doswapping ? (size_t)-1 : start;
 #if defined(VERBOSE)
-		printf("zdecompressed %d bytes to %d bytes...(%.2lf)\n", zz_bytes, decompressedbytes, zratio1);
+		printf("zdecompressed %d bytes to %d bytes...(%.2lf)\n", zz_bytes, slot.bytes, slot.zratio);
 #endif
+		return slot;
+	}
+
+	/*
+	 * Reads the chunk of block (ix, iy, iz) and decodes it. Returns the block's
+	 * first-stage stream of the channel read, valid until the chunk leaves the cache,
+	 * and its size in nbytes.
+	 */
+	const unsigned char * _fetch_block(int ix, int iy, int iz, int& nbytes, float& zratio1)
+	{
+		CompressedBlock compressedchunk = idx2chunk[_id(ix, iy, iz)];
+
+		const CachedChunk& chunk = _fetch_chunk(compressedchunk);
+		unsigned char * const waveletbuf = chunk.buf;
+		const size_t decompressedbytes = chunk.bytes;
+		zratio1 = chunk.zratio;
+
 		int readbytes = 0;
-		for(int i = 0; i<compressedchunk.subid; ++i)
+		for(int i = 0; i<_entry(compressedchunk); ++i)
 		{
 			int nbytes = * (int *) & waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
@@ -673,74 +822,33 @@ public:
 		}
 
 		{
-			int nbytes = *(int *)&waveletbuf[readbytes];
+			nbytes = *(int *)&waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
 			readbytes += sizeof(int);
 			assert(readbytes <= decompressedbytes);
 #if defined(VERBOSE)
 			printf("wavelet decompressing %d bytes...\n", nbytes);
 #endif
-			WaveletCompressor compressor;
-
-			{ // swapping
-			enum
-			{
-				BS3 = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_,
-				BITSETSIZE = (BS3 + 7) / 8
-			};
-
-			unsigned char *buf = & waveletbuf[readbytes];
-			for (int i = BITSETSIZE; i < nbytes; i+=4)
-				swapbytes(buf+i, 4);
-			}
-			memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
-			readbytes += nbytes;
 
-#if defined(_USE_WAVZ_)
+			_swap_survivors(&waveletbuf[readbytes], nbytes);
 
-			compressor.decompress(halffloat, nbytes, wtype, MYBLOCK);
-
-#elif defined(_USE_FPZIP_)
-			int fpzip_prec = (int) this->threshold;
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			int fpz_decompressedbytes;
-			fpz_decompress3D((char *)compressor.compressed_data(), nbytes, layout, (char *) MYBLOCK, (unsigned int *)&fpz_decompressedbytes, is_float, fpzip_prec);
+			return &waveletbuf[readbytes];
+		}
+	}
 
-			if ((fpz_decompressedbytes < 0)||(fpz_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("FPZ DECOMPRESSION FAILURE:  %d!!\n", fpz_decompressedbytes);
-				abort();
-			}
-#elif defined(_USE_ZFP_)
-			double zfp_acc = (double)this->threshold;
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			size_t zfp_decompressedbytes;
-
-			int status = zfp_decompress_buffer(MYBLOCK, layout[0], layout[1], layout[2], zfp_acc, is_float, (unsigned char *)compressor.compressed_data(), nbytes, &zfp_decompressedbytes);
-			if ((status < 0)||(zfp_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("ZFP DECOMPRESSION FAILURE:  %ld!!\n", zfp_decompressedbytes);
-				abort();
-			}
+	/*
+	 * Returns a decompressed cubism block into MYBLOCK 
+	 */
+	float load_block2(int ix, int iy, int iz, Real MYBLOCK[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_])
+	{
+		float zratio1, zratio2;
 
-#elif defined(_USE_SZ_)
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			int sz_decompressedbytes;
+		{
+			int nbytes;
+			const unsigned char * const stream = _fetch_block(ix, iy, iz, nbytes, zratio1);
 
-			sz_decompressedbytes = SZ_decompress_args(is_float?SZ_FLOAT:SZ_DOUBLE, (unsigned char *)compressor.compressed_data(), nbytes, MYBLOCK, 0, 0, layout[2], layout[1], layout[0]);
-			sz_decompressedbytes *= sizeof(Real);
-			if ((sz_decompressedbytes < 0)||(sz_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("SZ DECOMPRESSION FAILURE:  %d!!\n", sz_decompressedbytes);
-				abort();
-			}
+			_codec().decompress(stream, nbytes, &MYBLOCK[0][0][0]);
 
-#else
-                        memcpy((void *) MYBLOCK, (void *)compressor.compressed_data(), nbytes);
-#endif
 			const int BS3 = (_BLOCKSIZE_*_BLOCKSIZE_*_BLOCKSIZE_)*sizeof(Real);
 			zratio2 = (1.0*BS3)/nbytes;
 #if defined(VERBOSE)
@@ -748,11 +856,140 @@ public:
 #endif
 		}
 
-		fclose(f);
-
 		return zratio1*zratio2;
 	}
 
+	enum { BATCHBLOCKS = WaveletsOnInterval::FullTransformBatch<_BLOCKSIZE_>::K };
+
+	/*
+	 * Returns the n decompressed cubism blocks (ix[i], iy[i], iz[i]) into MYBLOCKS[i].
+	 * With wavelets, BATCHBLOCKS blocks at a time are inverse-transformed together.
+	 * The return value is the mean compression ratio of the blocks.
+	 */
+	float load_blocks2(const int n, const int ix[], const int iy[], const int iz[], Real MYBLOCKS[][_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_])
+	{
+		float zratio = 0;
+
+		if (codec == BlockCodecs::wavz)
+		{
+		enum { K = TransformBatch::K, BS3 = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_ };
+
+		if (batch == NULL)
+		{
+			batch = TransformBatch::create();
+			batchcoefficients.resize(K * BS3);
+		}
+
+		WaveletCompressor& compressor = _wavelets();
+		vector<Real>& coefficients = batchcoefficients;
+
+		for(int first = 0; first < n; first += K)
+		{
+			const int nb = std::min((int)K, n - first);
+
+			const Real * src[K];
+			Real * dst[K];
+
+			for(int k = 0; k < nb; ++k)
+			{
+				float zratio1;
+				int nbytes;
+				const unsigned char * const stream = _fetch_block(ix[first + k], iy[first + k], iz[first + k], nbytes, zratio1);
+
+				memcpy(compressor.compressed_data(), stream, nbytes);
+				compressor.load_coefficients(halffloat, nbytes);
+				memcpy(&coefficients[k * BS3], &compressor.uncompressed_data()[0][0][0], sizeof(Real) * BS3);
+
+				src[k] = &coefficients[k * BS3];
+				dst[k] = &MYBLOCKS[first + k][0][0][0];
+
+				zratio += zratio1 * (1.0 * BS3 * sizeof(Real)) / nbytes;
+			}
+
+			batch->pack(src, nb);
+			batch->iwt(wtype);
+			batch->unpack(dst, nb);
+		}
+		}
+		else
+		{
+		for(int i = 0; i < n; ++i)
+			zratio += load_block2(ix[i], iy[i], iz[i], MYBLOCKS[i]);
+		}
+
+		return n > 0 ? zratio / n : 0;
+	}
+
+	enum { MAXLOD = WaveletCompressor::MAXLOD };
+
+	/*
+	 * Level of detail: returns the n blocks (ix[i], iy[i], iz[i]) downsampled lod times,
+	 * (_BLOCKSIZE_ >> lod)^3 values each, one after the other in MYBLOCKS.
+	 * With wavelets only the coarse levels are decoded and inverted, the other schemes
+	 * decompress the full block and average it over 2^lod points in each direction.
+	 */
+	float load_blocks_lod(const int n, const int ix[], const int iy[], const int iz[], const int lod, Real * const MYBLOCKS)
+	{
+		typedef Real Block[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_];
+
+		MYASSERT(lod >= 0 && lod <= MAXLOD, "\nATTENZIONE:\nLevel of detail " << lod << " out of range [0, " << (int)MAXLOD << "]\n");
+
+		if (lod == 0)
+			return load_blocks2(n, ix, iy, iz, (Block *)MYBLOCKS);
+
+		const int LBS = _BLOCKSIZE_ >> lod;
+		const int LBS3 = LBS * LBS * LBS;
+
+		float zratio = 0;
+
+		if (codec == BlockCodecs::wavz)
+		{
+		WaveletCompressor& compressor = _wavelets();
+
+		for(int i = 0; i < n; ++i)
+		{
+			float zratio1;
+			int nbytes;
+			const unsigned char * const stream = _fetch_block(ix[i], iy[i], iz[i], nbytes, zratio1);
+
+			memcpy(compressor.compressed_data(), stream, nbytes);
+			compressor.decompress_lod(halffloat, nbytes, wtype, lod, MYBLOCKS + i * LBS3);
+
+			zratio += zratio1 * (1.0 * sizeof(Block)) / nbytes;
+		}
+		}
+		else
+		{
+		Block * const block = (Block *)malloc(sizeof(Block));
+		const int S = 1 << lod;
+
+		for(int i = 0; i < n; ++i)
+		{
+			zratio += load_block2(ix[i], iy[i], iz[i], *block);
+
+			Real * const dst = MYBLOCKS + i * LBS3;
+
+			for(int z = 0, c = 0; z < LBS; ++z)
+				for(int y = 0; y < LBS; ++y)
+					for(int x = 0; x < LBS; ++x, ++c)
+					{
+						double sum = 0;
+
+						for(int dz = 0; dz < S; ++dz)
+							for(int dy = 0; dy < S; ++dy)
+								for(int dx = 0; dx < S; ++dx)
+									sum += (*block)[S * z + dz][S * y + dy][S * x + dx];
+
+						dst[c] = sum / (S * S * S);
+					}
+		}
+
+		free(block);
+		}
+
+		return n > 0 ? zratio / n : 0;
+	}
+
 #if defined(_OPT_DECOMPRESSION_)
 	/*
 	 * Optimized block loading based on caching of previously decompressed chunks of blocks
@@ -797,7 +1034,7 @@ public:
 		t0 = MPI_Wtime();
 		size_t decompressedbytes = 0;
 		if (!ready)
-			decompressedbytes = zdecompress(compressedbuf, compressedchunk.extent, &waveletbuf[0], 4*1024*1024);
+			decompressedbytes = zdecompress(compressedbuf, compressedchunk.extent, &waveletbuf[0], 4*1024*1024, encoder);
 
 		t1 = MPI_Wtime();
 		t_decode += (t1-t0);
@@ -810,7 +1047,7 @@ public:
 		printf("zdecompressed %d bytes to %d bytes...(%.2lf)\n", zz_bytes, decompressedbytes, zratio1);
 #endif
 		int readbytes = 0;
-		for(int i = 0; i<compressedchunk.subid; ++i)
+		for(int i = 0; i<_entry(compressedchunk); ++i)
 		{
 			int nbytes = * (int *) & waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
@@ -829,68 +1066,12 @@ public:
 #if defined(VERBOSE)
 			printf("wavelet decompressing %d bytes...\n", nbytes);
 #endif
-			WaveletCompressor compressor;
 
-			{ // swapping
-			enum
-			{
-				BS3 = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_,
-				BITSETSIZE = (BS3 + 7) / 8
-			};
+			_swap_survivors(&waveletbuf[readbytes], nbytes);
 
-			unsigned char *buf = & waveletbuf[readbytes];
-			for (int i = BITSETSIZE; i < nbytes; i+=4)
-				swapbytes(buf+i, 4);
-			}
-			memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
+			_codec().decompress(&waveletbuf[readbytes], nbytes, &MYBLOCK[0][0][0]);
 			readbytes += nbytes;
 
-#if defined(_USE_WAVZ_)
-
-			compressor.decompress(halffloat, nbytes, wtype, MYBLOCK);
-
-#elif defined(_USE_FPZIP_)
-			int fpzip_prec = (int) this->threshold;
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			int fpz_decompressedbytes;
-
-			fpz_decompress3D((char *)compressor.compressed_data(), nbytes, layout, (char *) MYBLOCK, (unsigned int *)&fpz_decompressedbytes, is_float, fpzip_prec);
-			if ((fpz_decompressedbytes < 0)||(fpz_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("FPZ DECOMPRESSION FAILURE:  %d!!\n", fpz_decompressedbytes);
-				abort();
-			}
-
-#elif defined(_USE_ZFP_)
-			double zfp_acc = (double)this->threshold;
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			size_t zfp_decompressedbytes;
-
-			int status = zfp_decompress_buffer(MYBLOCK, layout[0], layout[1], layout[2], zfp_acc, is_float, (unsigned char *)compressor.compressed_data(), nbytes, &zfp_decompressedbytes);
-			if ((status < 0)||(zfp_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("ZFP DECOMPRESSION FAILURE:  %ld!!\n", zfp_decompressedbytes);
-				abort();
-			}
-
-#elif defined(_USE_SZ_)
-			int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-			int is_float = (sizeof(Real)==4)?1:0;
-			int sz_decompressedbytes;
-
-			sz_decompressedbytes = SZ_decompress_args(is_float?SZ_FLOAT:SZ_DOUBLE, (unsigned char *)compressor.compressed_data(), nbytes, MYBLOCK, 0, 0, layout[2], layout[1], layout[0]);
-			sz_decompressedbytes *= sizeof(Real);
-			if ((sz_decompressedbytes < 0)||(sz_decompressedbytes != ((_BLOCKSIZE_)*(_BLOCKSIZE_)*(_BLOCKSIZE_)*sizeof(Real))))
-			{
-				printf("SZ DECOMPRESSION FAILURE:  %d!!\n", sz_decompressedbytes);
-				abort();
-			}
-
-#else
-                        memcpy((void *) MYBLOCK, (void *)compressor.compressed_data(), nbytes);
-#endif
 			const int BS3 = (_BLOCKSIZE_*_BLOCKSIZE_*_BLOCKSIZE_)*sizeof(Real);
 			zratio2 = (1.0*BS3)/nbytes;
 #if defined(VERBOSE)
@@ -938,6 +1119,12 @@ public:
 			MPI_Bcast(totalbpd, sizeof(totalbpd), MPI_CHAR, 0, comm);
 			MPI_Bcast(bpd, sizeof(bpd), MPI_CHAR, 0, comm);
 			MPI_Bcast(&halffloat, sizeof(halffloat), MPI_CHAR, 0, comm);
+			MPI_Bcast(&sigmap, sizeof(sigmap), MPI_CHAR, 0, comm);
+			MPI_Bcast(&quantizer, sizeof(quantizer), MPI_CHAR, 0, comm);
+			MPI_Bcast(&shuffle, sizeof(shuffle), MPI_CHAR, 0, comm);
+			MPI_Bcast(&encoder, sizeof(encoder), MPI_CHAR, 0, comm);
+			MPI_Bcast(&codec, sizeof(codec), MPI_CHAR, 0, comm);
+			MPI_Bcast(&wtype, sizeof(wtype), MPI_CHAR, 0, comm);
 			MPI_Bcast(&doswapping, sizeof(doswapping), MPI_CHAR, 0, comm);
 			MPI_Bcast(&threshold, sizeof(threshold), MPI_CHAR, 0, comm);
 		}
@@ -33,6 +33,7 @@ typedef double Real;
 #include "../../Compressor/source/WaveletSerializationTypes.h"
 #include "../../Compressor/source/CompressionEncoders_plain.h"
 #include "../../Compressor/source/FullWaveletTransform.h"
+#include "../../Compressor/source/Container.h"
 
 //MACRO TAKEN FROM http://stackoverflow.com/questions/3767869/adding-message-to-assert
 #   define MYASSERT(condition, message) \
@@ -57,7 +58,14 @@ protected:
 	int miniheader_bytes;
 	int NBLOCKS;
 	int totalbpd[3], bpd[3];
-	bool halffloat;
+	int halffloat;	// HalfFloat::Format
+	int sigmap;	// SignificanceMap::Format
+	int quantizer;	// BitPlane::Format
+	int maxplanes;	// bit planes decoded at most, with quantizer
+	int channels;	// of each block, one after the other in its chunk
+	int channel;	// the one that is read
+	int step;	// of the record read in a container, -1 for a file of its own
+	string field;	// of the record
 
 	vector<CompressedBlock> idx2chunk;
 
@@ -70,6 +78,12 @@ protected:
 		return ix + totalbpd[0] * ( iy + totalbpd[1] * iz );
 	}
 
+	/* the entry of the chunk with the stream of the block, for the channel read */
+	int _entry(const CompressedBlock& compressedchunk) const
+	{
+		return compressedchunk.subid * channels + channel;
+	}
+
 	// peh: BGQ <-> x86_64
 	void swapbytes(unsigned char *mem, int nbytes)
 	{
@@ -175,7 +189,27 @@ protected:
 
 public:
 
-	Reader_WaveletCompression_plain(const string path, bool doswapping, int wtype): path(path), doswapping(doswapping), wtype(wtype), global_header_displacement(-1), NBLOCKS(-1){ }
+	Reader_WaveletCompression_plain(const string path, bool doswapping, int wtype): path(path), doswapping(doswapping), wtype(wtype), global_header_displacement(-1), NBLOCKS(-1), maxplanes(BitPlane::MAXPLANES), channels(1), channel(0), step(-1) { }
+
+	// the channel of the blocks read, in the files of several channels
+	void set_channel(const int channel)
+	{
+		MYASSERT(channel >= 0 && channel < channels, "\nATTENZIONE:\nChannel " << channel << " and the file has " << channels << "\n");
+
+		this->channel = channel;
+	}
+
+	int nchannels() const { return channels; }
+
+	// the record of step and field is read, in a container (see Container.h)
+	void set_record(const int step, const string field)
+	{
+		this->step = step;
+		this->field = field;
+	}
+
+	// progressive precision: quantized survivors are decoded from their first maxplanes bit planes
+	void set_maxplanes(const int maxplanes) { this->maxplanes = maxplanes; }
 
 	virtual void load_file()
 	{
@@ -198,14 +232,29 @@ public:
 
 			MYASSERT(file, "\nAAATTENZIONE:\nOooops could not open the file. Path: " << path);
 
+			//the record of step and field, the offsets in it are relative to its start
+			size_t record = 0;
+			if (step >= 0)
+			{
+				Container::Index index;
+				const bool container = Container::read(path, index);
+				MYASSERT(container, "\nATTENZIONE:\n" << path << " is not a container\n");
+
+				const Container::Entry * const entry = Container::find(index.entries, step, field);
+				MYASSERT(entry, "\nATTENZIONE:\nNo step " << step << " of field " << field << " in the container " << path << "\n");
+
+				record = entry->offset;
+				fseek(file, record, SEEK_SET);
+			}
+
 			//reading the header and mini header
 			{
 				size_t header_displacement = -1;
 				fread(&header_displacement, sizeof(size_t), 1, file);
 				header_displacement = swaplong(header_displacement);
 
-				fseek(file, header_displacement, SEEK_SET);
-				global_header_displacement = header_displacement;
+				fseek(file, record + header_displacement, SEEK_SET);
+				global_header_displacement = record + header_displacement;
 
 				char buf[1024];
 				fgets(buf, sizeof(buf), file);
@@ -278,7 +327,9 @@ public:
 
 				fscanf(file, "HalfFloat: %s\n", buf);
 				printf("HalfFloat: <%s>\n", buf);
-				this->halffloat = (string(buf) == "yes");
+				this->halffloat = HalfFloat::parse_header(buf);
+
+				MYASSERT(this->halffloat >= 0, "\nATTENZIONE:\nHalfFloat in the file is " << buf << "\n");
 
 				fscanf(file, "Wavelets: %s\n", buf);
 				printf("Wavelets: <%s>\n", buf);
@@ -312,6 +363,33 @@ public:
 				fscanf(file, "WaveletThreshold: %f\n", &mythreshold);
 				printf("WaveletThreshold: <%f>\n", mythreshold);
 
+				// optional, older files have bitset masks
+				this->sigmap = SignificanceMap::bitset;
+				if (fscanf(file, "SignificanceMap: %s\n", buf) == 1)
+				{
+					printf("SignificanceMap: <%s>\n", buf);
+					this->sigmap = SignificanceMap::parse(buf);
+				}
+
+				MYASSERT(this->sigmap >= 0, "\nATTENZIONE:\nSignificanceMap in the file is " << buf << "\n");
+
+				this->quantizer = BitPlane::none;
+				if (fscanf(file, "Quantization: %s\n", buf) == 1)
+				{
+					printf("Quantization: <%s>\n", buf);
+					this->quantizer = BitPlane::parse(buf);
+				}
+
+				MYASSERT(this->quantizer >= 0, "\nATTENZIONE:\nQuantization in the file is " << buf << "\n");
+
+				// optional, the files of one channel do not have it
+				this->channels = 1;
+				if (fscanf(file, "Channels: %d\n", &this->channels) == 1)
+					printf("Channels: <%d>\n", this->channels);
+
+				MYASSERT(this->channels >= 1, "\nATTENZIONE:\nChannels in the file is " << this->channels << "\n");
+				this->channel = 0;
+
 				fscanf(file, "Encoder: %s\n", buf);
 				printf("Encoder: <%s>\n", buf);
 
@@ -364,7 +442,7 @@ public:
 
 				//bool done = false;
 
-				size_t base = miniheader_bytes;
+				size_t base = record + miniheader_bytes;
 
 				const int BPS = bpd[0] * bpd[1] * bpd[2];
 				assert(NBLOCKS % BPS == 0);
@@ -377,19 +455,6 @@ public:
 				for (int h = 0; h < SUBDOMAINS; h++) swapHL(hl[h]);
 				}
 
-				{
-					int c = fgetc(file);
-
-					do
-					{
-						// printf("shouldnt be here! 0x%x\n", c);
-						//abort();
-						c = fgetc(file);
-					}
-					while (! feof(file) );
-				}
-				//assert(feof(file));
-
 				for(int s = 0, currblock = 0; s < SUBDOMAINS; ++s)
 				{
 					const int nglobalchunks = lutchunks.size();
@@ -511,11 +576,11 @@ public:
 
 		assert(!feof(f));
 
-		static vector<unsigned char> waveletbuf(2 << 22);	// 21: 4MB, 22: 8MB, 28: 512MB
+		static vector<unsigned char> waveletbuf(max(2 << 22, (int)sizeof(WaveletCompressor) + (int)sizeof(int)));	// 8MB, or one block for large _BLOCKSIZE_
 		const size_t decompressedbytes = zdecompress_plain(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size());
 
 		int readbytes = 0;
-		for(int i = 0; i<compressedchunk.subid; ++i)
+		for(int i = 0; i<_entry(compressedchunk); ++i)
 		{
 			int nbytes = * (int *) & waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
@@ -530,7 +595,7 @@ public:
 			nbytes = swapint(nbytes);
 			readbytes += sizeof(int);
 			assert(readbytes <= decompressedbytes);
-			WaveletCompressor compressor;
+			static WaveletCompressor compressor;	// 2 * _BLOCKSIZE_^3 values: not on the stack
 
 			{ // swapping
 			enum
@@ -544,6 +609,8 @@ public:
 				swapbytes(buf+i, 4);
 			}
 
+			compressor.set_sigmap(sigmap);
+			compressor.set_quantizer(quantizer, maxplanes);
 			memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
 			readbytes += nbytes;
 
@@ -576,14 +643,14 @@ public:
 		assert(!feof(f));
 
 		size_t zz_bytes = compressedbuf.size();
-		static vector<unsigned char> waveletbuf(2 << 22);	// 21: 4MB, 22: 8MB, 28: 512MB
+		static vector<unsigned char> waveletbuf(max(2 << 22, (int)sizeof(WaveletCompressor) + (int)sizeof(int)));	// 8MB, or one block for large _BLOCKSIZE_
 		const size_t decompressedbytes = zdecompress_plain(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size());
 		zratio1 = (1.0*decompressedbytes)/zz_bytes;
 #if defined(VERBOSE)
 		printf("zdecompressed %d bytes to %d bytes...(%.2lf)\n", zz_bytes, decompressedbytes, zratio1);
 #endif
 		int readbytes = 0;
-		for(int i = 0; i<compressedchunk.subid; ++i)
+		for(int i = 0; i<_entry(compressedchunk); ++i)
 		{
 			int nbytes = * (int *) & waveletbuf[readbytes];
 			nbytes = swapint(nbytes);
@@ -601,7 +668,7 @@ public:
 #if defined(VERBOSE)
 			printf("wavelet decompressing %d bytes...\n", nbytes);
 #endif
-			WaveletCompressor compressor;
+			static WaveletCompressor compressor;	// 2 * _BLOCKSIZE_^3 values: not on the stack
 
 			{ // swapping
 			enum
@@ -614,6 +681,8 @@ public:
 			for (int i = BITSETSIZE; i < nbytes; i+=4)
 				swapbytes(buf+i, 4);
 			}
+			compressor.set_sigmap(sigmap);
+			compressor.set_quantizer(quantizer, maxplanes);
 			memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
 			readbytes += nbytes;
 
@@ -660,6 +729,8 @@ public:
 			MPI_Bcast(totalbpd, sizeof(totalbpd), MPI_CHAR, 0, comm);
 			MPI_Bcast(bpd, sizeof(bpd), MPI_CHAR, 0, comm);
 			MPI_Bcast(&halffloat, sizeof(halffloat), MPI_CHAR, 0, comm);
+			MPI_Bcast(&sigmap, sizeof(sigmap), MPI_CHAR, 0, comm);
+			MPI_Bcast(&quantizer, sizeof(quantizer), MPI_CHAR, 0, comm);
 			MPI_Bcast(&doswapping, sizeof(doswapping), MPI_CHAR, 0, comm);
 		}
 
@@ -23,7 +23,9 @@ static int omp_get_thread_num(void) { return 0; }
 #endif
 
 #include <Timer.h>
+#include <algorithm>
 #include <map>
+#include <deque>
 
 using namespace std;
 
@@ -32,28 +34,11 @@ using namespace std;
 #include "WaveletCompressor.h"
 
 #include "CompressionEncoders.h"
+#include "BlockCodecs.h"
+#include "SlabBuffer.h"
+#include "Container.h"
 //#define	_WRITE_AT_ALL_	1	// peh:
 
-#if defined(_USE_ZEROBITS_)
-void float_zero_bits(unsigned int *ul, int n)
-{
-        unsigned int _ul = *ul;
-
-        if (n == 0)
-                _ul = _ul;
-        else if (n == 4)
-                _ul = _ul & 0xfffffff0;
-        else if (n == 8)
-                _ul = _ul & 0xffffff00;
-        else if (n == 12)
-                _ul = _ul & 0xfffff000;
-        else if (n == 16)
-                _ul = _ul & 0xffff0000;
-
-        *ul = _ul;
-}
-#endif
-
 template<typename GridType, typename IterativeStreamer>
 class SerializerIO_WaveletCompression_MPI_SimpleBlocking
 {
@@ -65,10 +50,13 @@ protected:
 		NPTS = _BLOCKSIZE_ * _BLOCKSIZE_ * _BLOCKSIZE_
 	};
 
-	enum //some considerations about the per-thread working set
+	/* some considerations about the per-thread working set: an entry is the transform and
+	   the stream of a block, not sizeof(WaveletCompressor), so that the members of the
+	   compressor do not move the chunks */
+	enum
 	{
 	  DESIREDMEM = (4 * 1024) * 1024,
-	  ENTRYSIZE = sizeof(WaveletCompressor) + sizeof(int),
+	  ENTRYSIZE = sizeof(WaveletsOnInterval::FullTransform<_BLOCKSIZE_>) + WaveletCompressor::MAXSTREAMBYTES + sizeof(int),
 	  ENTRIES_CANDIDATE = DESIREDMEM / ENTRYSIZE,
 	  ENTRIES = ENTRIES_CANDIDATE ? ENTRIES_CANDIDATE : 1,
 	  BUFFERSIZE = ENTRIES * ENTRYSIZE,
@@ -83,16 +71,47 @@ protected:
 
 	struct TimingInfo { float total, fwt, encoding; };
 
+	enum
+	{
+		MAXPENDING = 4,	// writes of slabs in flight, while streaming
+		MAXRESIDENT = 8	// slabs in memory, while streaming, besides those of the chunks being copied
+	};
+
+	struct WriteBehind
+	{
+		MPI_File file;	// MPI_FILE_NULL unless streaming
+		size_t offset;	// of my data in the file
+		size_t bytes;	// of my data, from the first pass
+		int posted;	// slabs whose write was posted, the first ones
+		deque< MPI_Request > requests;	// of the slabs posted - requests.size() to posted - 1
+	};
+
 	string binaryocean_title, binarylut_title, header;
 
 	vector< BlockMetadata > myblockindices; //tells in which compressed chunk is any block, nblocks
 	HeaderLUT lutheader;
 	vector< size_t > lut_compression; //tells the number of compressed chunk, and where do they start, nchunks + 2
-	vector< unsigned char > allmydata; //buffer with the compressed data
-	size_t written_bytes, pending_writes, completed_writes;
+	vector< vector< size_t > > thread_luts; //per-thread start of the chunks, merged into lut_compression
+	SlabBuffer allmydata; //buffer with the compressed data
+	size_t written_bytes;
+	bool streaming;	// the data is compressed twice: sizes first, then written behind the compression
+	bool sizing;	// first pass of streaming, nothing is stored
+	WriteBehind writebehind;
+	int cstep;	// of the record appended to a container, -1 for a file of its own
+	string cfield;	// of the record
+	size_t recordbase;	// offset of the record in the file
+	Container::Index cindex;	// of the container, on rank 0
 
 	Real threshold;
-	bool halffloat, verbosity;
+	int halffloat;	// HalfFloat::Format of the wavelet survivors
+	int sigmap;	// SignificanceMap::Format of the wavelet masks
+	int quantizer;	// BitPlane::Format of the wavelet survivors
+	int codec;	// BlockCodecs::Kind, first stage
+	int shuffle;	// Shuffle::Format of the output of the first stage
+	ZeroBits::Settings zerobits;	// mantissa trimming of the wavelet survivors or of the data
+	Encoder::Settings encoder;	// second stage
+	int wchannels;	// written for each block: 1, or all of them one after the other
+	bool verbosity;
 	int wtype_read, wtype_write;	// peh
 
 	vector< float > workload_total, workload_fwt, workload_encode; //per-thread cpu time for imbalance insight for fwt and encoding
@@ -102,8 +121,8 @@ protected:
 	{
 		//0. setup
 		//1. compress the data with zlib, obtain zptr, zbytes
-		//2. obtain an offset from allmydata -> dstoffset
-		//3. obtain a new entry in lut_compression -> idcompression
+		//2. reserve [dstoffset, dstoffset+zbytes) in allmydata, lock-free
+		//3. obtain a new entry in the lut of my thread -> idcompression, made global by _merge_luts
 		//4. copy the [zptr,zptr+zbytes] into in allmydata, starting from dstoffset
 		//5. for all blocks, set the myblockindices[blockids[i]] to a valid state
 		//6. set nblocks to zero
@@ -115,55 +134,46 @@ protected:
 		int idcompression = -1;
 
 		//1.
-		/* ZLIB/LZ4 (LOSSLESS COMPRESSION) */
+		/* ZLIB/LZ4/RANS (LOSSLESS COMPRESSION) */
 		{
-			/* TODO: replace the following code with: zbytes = zcompress(inputbuffer, bufsize, maxsize); */
-			z_stream myzstream = {0};
-			deflateInit(&myzstream, Z_DEFAULT_COMPRESSION); // Z_BEST_COMPRESSION
-			//deflateInit(&myzstream, Z_BEST_COMPRESSION);
+			Rans::Planes planes;
 
-			unsigned mah = maxsize;
-			int err = deflate_inplace(&myzstream, inputbuffer, bufsize, &mah);
+			if (encoder.format == Encoder::rans && codec == BlockCodecs::wavz && quantizer == BitPlane::none && shuffle != Shuffle::none)
+				_shuffled_survivors(inputbuffer, bufsize, planes);
 
-			assert(err == Z_OK);
+			unsigned mah = maxsize;
+			const int err = encode_inplace(encoder, inputbuffer, bufsize, &mah, &planes);
 
-			zbytes = myzstream.total_out;
+			if (err != Z_OK)
+			{
+				printf("SerializerIO_WaveletCompression_MPI_Simple.h: %s failed on %ld bytes (%d)!!\n", Encoder::name(encoder.format), bufsize, err);
+				abort();
+			}
 
-			// fixed memory leak, Fabian (08 Oct 2014)
-			err = deflateEnd(&myzstream);
-			assert(err == Z_OK);
+			zbytes = mah;
 		}
 
-		//2-3.
-#pragma omp critical
-		{
-			dstoffset = written_bytes;
-			written_bytes += zbytes;
-
-			//exception: we have to resize allmydata
-			if (written_bytes > allmydata.size())
-			{
-				//yield-based wait until writes complete
-				while (pending_writes != completed_writes) sched_yield();
-
-				//safely resize
-				printf("resizing allmydata to %ld bytes\n", written_bytes);
-				allmydata.resize(written_bytes);
-				
-			}
+		//2.
+#pragma omp atomic capture
+		{ dstoffset = written_bytes; written_bytes += zbytes; }
 
-			idcompression = lut_compression.size();
-			lut_compression.push_back(dstoffset);
+		//3.
+		{
+			const int tid = omp_get_thread_num();
+			vector< size_t >& mylut = thread_luts[tid];
 
-			++pending_writes;
+			idcompression = mylut.size() * thread_luts.size() + tid;
+			mylut.push_back(dstoffset);
 		}
 
 		//4.
-		assert(allmydata.size() >= written_bytes);
-		memcpy(&allmydata.front() + dstoffset, zptr, zbytes);
+		if (!sizing)
+		{
+			if (writebehind.file != MPI_FILE_NULL)
+				_wait_resident(dstoffset);
 
-#pragma omp atomic
-		++completed_writes;
+			allmydata.write(dstoffset, zptr, zbytes);
+		}
 
 		//5.
 		for(int i = 0; i < nblocks; ++i)
@@ -180,145 +190,249 @@ protected:
 		bufsize = 0;
 		nblocks = 0;
 
-		return timer.stop();
+		const float t = timer.stop();
+
+		if (writebehind.file != MPI_FILE_NULL)
+		{
+#pragma omp critical (writebehind)
+			_write_behind(false);
+		}
+
+		return t;
 	}
 
+	/* the shuffled survivors of the wavelet streams of a chunk, [int nbytes][stream] each:
+	   rans gives their byte planes models of their own */
+	void _shuffled_survivors(const unsigned char * const buf, const long bytes, Rans::Planes& planes)
+	{
+		planes.esize = HalfFloat::size(halffloat, sizeof(Real));
 
-	template<int channel>
-	void _compress(const vector<BlockInfo>& vInfo, const int NBLOCKS, IterativeStreamer streamer)
+		for(long i = 0; i < bytes; )
+		{
+			int nbytes;
+			memcpy(&nbytes, buf + i, sizeof(nbytes));
+			i += sizeof(nbytes);
+
+			const int offset = WaveletCompressor::survivors_offset(buf + i, sigmap);
+
+			if (nbytes > offset)
+			{
+				const Rans::Region r = { (size_t)(i + offset), (size_t)(nbytes - offset) };
+				planes.regions.push_back(r);
+			}
+
+			i += nbytes;
+		}
+	}
+
+	/* streaming: posts the writes of the slabs of allmydata that are complete (all of them
+	   if last), in order, and frees the slabs written to the file. the threads call it one
+	   at a time (omp critical writebehind), as MPI_THREAD_SERIALIZED wants */
+	void _write_behind(const bool last, bool wait = false)
 	{
-		int compress_threads = omp_get_max_threads();
-		if (compress_threads < 1) compress_threads = 1;
+		WriteBehind& wb = writebehind;
+		const int nslabs = last ? allmydata.count(written_bytes) : (int)SlabBuffer::MAXSLABS;
 
-#pragma omp parallel 
+		for(; wb.posted < nslabs && (last || allmydata.full(wb.posted)); ++wb.posted)
 		{
-		  const int tid = omp_get_thread_num();
+			const int k = wb.posted;
+			const int nbytes = last ? allmydata.bytes(k, written_bytes) : (int)SlabBuffer::SLABBYTES;
 
-		  CompressionBuffer & mybuf = workbuffer[tid];
+			// beyond the bytes of the first pass are those of the next rank
+			if ((size_t)k * SlabBuffer::SLABBYTES + nbytes > wb.bytes)
+			{
+				printf("SerializerIO_WaveletCompression_MPI_Simple.h: streaming, more than the %ld bytes of the first pass!!\n", (long)wb.bytes);
+				abort();
+			}
 
-			long mybytes = 0; int myhotblocks = 0;
+			MPI_Request request;
+			MPI_File_iwrite_at(wb.file, wb.offset + (size_t)k * SlabBuffer::SLABBYTES, allmydata.slab(k), nbytes, MPI_CHAR, &request);
 
-			float tfwt = 0, tencode = 0;
-			Timer timer;
-			timer.start();
+			wb.requests.push_back(request);
+		}
 
-#pragma omp for
-			for(int i = 0; i < NBLOCKS; ++i)
+		// the oldest ones first, waiting for those beyond MAXPENDING (or the oldest, if wait)
+		while (!wb.requests.empty())
+		{
+			int done = 0;
+			MPI_Status status;
+
+			if (last || wait || wb.requests.size() > MAXPENDING)
 			{
-				Timer tw; tw.start();
+				MPI_Wait(&wb.requests.front(), &status);
+				done = 1;
+			}
+			else
+				MPI_Test(&wb.requests.front(), &done, &status);
 
-				//wavelet compression
-				{
-					FluidBlock& b = *(FluidBlock*)vInfo[i].ptrBlock;
+			if (!done)
+				break;
 
-					WaveletCompressor compressor;
+			allmydata.release(wb.posted - wb.requests.size());
+			wb.requests.pop_front();
+			wait = false;
+		}
+	}
 
-					Real * const mysoabuffer = &compressor.uncompressed_data()[0][0][0];
-					if(streamer.name() == "StreamerGridPointIterative")
-					{
-					for(int iz=0; iz<FluidBlock::sizeZ; iz++)
-						for(int iy=0; iy<FluidBlock::sizeY; iy++)
-							for(int ix=0; ix<FluidBlock::sizeX; ix++)
-								mysoabuffer[ix + _BLOCKSIZE_ * (iy + _BLOCKSIZE_ * iz)] = streamer.template operate<channel>(b(ix, iy, iz));
-					}
-					else
-					{
-					IterativeStreamer mystreamer(b);
-					for(int iz=0; iz<FluidBlock::sizeZ; iz++)
-						for(int iy=0; iy<FluidBlock::sizeY; iy++)
-							for(int ix=0; ix<FluidBlock::sizeX; ix++)
-								mysoabuffer[ix + _BLOCKSIZE_ * (iy + _BLOCKSIZE_ * iz)] = mystreamer.operate(ix, iy, iz);
-					}
+	/* streaming: a write at offset waits until the slabs before its own are at most
+	   MAXRESIDENT. the first slab not released is being filled by a thread that does not wait */
+	void _wait_resident(const size_t offset)
+	{
+		const int k = offset / SlabBuffer::SLABBYTES;
 
+		for(bool ready = false; !ready; )
+		{
+#pragma omp critical (writebehind)
+			{
+				const WriteBehind& wb = writebehind;
 
-					//wavelet digestion
-#if defined(_USE_WAVZ_) 
-					const int nbytes = (int)compressor.compress(this->threshold, this->halffloat, this->wtype_write);
-					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
-					mybytes += sizeof(nbytes);
+				ready = k < wb.posted - (int)wb.requests.size() + MAXRESIDENT;
 
-					memcpy(mybuf.compressedbuffer + mybytes, compressor.compressed_data(), sizeof(unsigned char) * nbytes);
+				if (!ready)
+					_write_behind(false, true);
+			}
+		}
+	}
 
-#elif defined(_USE_FPZIP_)
-					const int inbytes = FluidBlock::sizeX * FluidBlock::sizeY * FluidBlock::sizeZ * sizeof(Real);
-					int nbytes;
 
-					int is_float = (sizeof(Real)==4)? 1 : 0;
-					int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-					int fpzip_prec = (int)this->threshold;
-					fpz_compress3D((void *)mysoabuffer, inbytes, layout, (void *) compressor.compressed_data(), (unsigned int *)&nbytes, is_float, fpzip_prec);
+	/* lut_compression from the luts of the threads: the chunks are numbered by their start,
+	   as the readers want them */
+	void _merge_luts()
+	{
+		const int nthreads = thread_luts.size();
 
-					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
-					mybytes += sizeof(nbytes);
-					memcpy(mybuf.compressedbuffer + mybytes, compressor.compressed_data(), sizeof(unsigned char) * nbytes);
-
-#elif defined(_USE_ZFP_)
-					const int inbytes = FluidBlock::sizeX * FluidBlock::sizeY * FluidBlock::sizeZ * sizeof(Real);
-					int nbytes;
-
-					double zfp_acc = this->threshold;
-					int is_float = (sizeof(Real)==4)? 1 : 0;
-					int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
-					size_t nbytes_zfp;
-					int status = zfp_compress_buffer(mysoabuffer, layout[0], layout[1], layout[2], zfp_acc, is_float, (unsigned char *)compressor.compressed_data(), &nbytes_zfp);
-					nbytes = nbytes_zfp;
-#if VERBOSE
-					printf("zfp_compress status = %d, from %d to %d bytes = %d\n", status, inbytes, nbytes);
-#endif
+		vector< pair<size_t, int> > chunks; // start, temporary idcompression
+		for(int t = 0; t < nthreads; ++t)
+			for(int i = 0; i < (int)thread_luts[t].size(); ++i)
+				chunks.push_back(make_pair(thread_luts[t][i], i * nthreads + t));
 
-					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
-					mybytes += sizeof(nbytes);
-					memcpy(mybuf.compressedbuffer + mybytes, compressor.compressed_data(), sizeof(unsigned char) * nbytes);
+		sort(chunks.begin(), chunks.end());
 
-#elif defined(_USE_SZ_)
-					const int inbytes = FluidBlock::sizeX * FluidBlock::sizeY * FluidBlock::sizeZ * sizeof(Real);
-					int nbytes;
-					int is_float = (sizeof(Real)==4)? 1 : 0;
+		const int nchunks = chunks.size();
 
-					double sz_abs_acc = 0.0;
-					double sz_rel_acc = 0.0;
-					double sz_pwr_acc = 0.0;
+		int maxid = 0;
+		for(int i = 0; i < nchunks; ++i)
+			maxid = max(maxid, chunks[i].second + 1);
 
-					int sz_pwr_type = SZ_PWR_MAX_TYPE;
+		vector< int > globalid(maxid, -1);
 
-					if(getenv("SZ_ABS_ACC")) sz_abs_acc = atof(getenv("SZ_ABS_ACC"));
-					sz_abs_acc = (double) this->threshold;
+		lut_compression.resize(nchunks);
+		for(int i = 0; i < nchunks; ++i)
+		{
+			lut_compression[i] = chunks[i].first;
+			globalid[chunks[i].second] = i;
+		}
 
-					int layout[4] = {_BLOCKSIZE_, _BLOCKSIZE_, _BLOCKSIZE_, 1};
+		for(size_t i = 0; i < myblockindices.size(); ++i)
+		{
+			myblockindices[i].idcompression = globalid[myblockindices[i].idcompression];
+			assert(myblockindices[i].idcompression >= 0);
+		}
 
-					size_t *bytes_sz = (size_t *)malloc(sizeof(size_t));
-					unsigned char *compressed_sz = SZ_compress_args(is_float? SZ_FLOAT:SZ_DOUBLE, (unsigned char *)mysoabuffer, bytes_sz, ABS, sz_abs_acc, sz_rel_acc, sz_pwr_acc, sz_pwr_type, 0, 0, layout[2], layout[1], layout[0]);
+		for(int t = 0; t < nthreads; ++t)
+			thread_luts[t].clear();
+	}
 
-					nbytes = *bytes_sz;
-					memcpy(compressor.compressed_data(), compressed_sz, nbytes);
-					free(bytes_sz);
-					free(compressed_sz);
+	template<int channel>
+	void _fill(const BlockInfo& info, IterativeStreamer& streamer, Real * const mysoabuffer)
+	{
+		FluidBlock& b = *(FluidBlock*)info.ptrBlock;
 
-#if VERBOSE
-					printf("SZ_compress_args: from %d to %d bytes\n", inbytes, nbytes);
-#endif
+		if(streamer.name() == "StreamerGridPointIterative")
+		{
+		for(int iz=0; iz<FluidBlock::sizeZ; iz++)
+			for(int iy=0; iy<FluidBlock::sizeY; iy++)
+				for(int ix=0; ix<FluidBlock::sizeX; ix++)
+					mysoabuffer[ix + _BLOCKSIZE_ * (iy + _BLOCKSIZE_ * iz)] = streamer.template operate<channel>(b(ix, iy, iz));
+		}
+		else
+		{
+		IterativeStreamer mystreamer(b);
+		for(int iz=0; iz<FluidBlock::sizeZ; iz++)
+			for(int iy=0; iy<FluidBlock::sizeY; iy++)
+				for(int ix=0; ix<FluidBlock::sizeX; ix++)
+					mysoabuffer[ix + _BLOCKSIZE_ * (iy + _BLOCKSIZE_ * iz)] = mystreamer.operate(ix, iy, iz);
+		}
+	}
 
-					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
-					mybytes += sizeof(nbytes);
-					memcpy(mybuf.compressedbuffer + mybytes, compressor.compressed_data(), sizeof(unsigned char) * nbytes);
+	/* _fill of channel c, known at run time */
+	template<int channel>
+	void _fill_any(const int c, const BlockInfo& info, IterativeStreamer& streamer, Real * const mysoabuffer)
+	{
+		if (c == channel || channel == NCHANNELS - 1)
+			_fill<channel>(info, streamer, mysoabuffer);
+		else
+			_fill_any<(channel + 1) % NCHANNELS>(c, info, streamer, mysoabuffer);
+	}
 
-#else /* NO COMPRESSION */
+	/* the channel of the c-th stream of a block */
+	int _channel(const int channel, const int c) const { return wchannels > 1 ? c : channel; }
+
+	/* the wavelet transform of K blocks at a time: the blocks are packed into the lanes of a
+	   FullTransformBatch, transformed together, and then thresholded and encoded one by one.
+	   with several channels, a channel at a time, and the channels of a block are encoded
+	   one after the other */
+	template<int channel>
+	void _compress_batched(const vector<BlockInfo>& vInfo, const int NBLOCKS, IterativeStreamer streamer,
+			       CompressionBuffer& mybuf, long& mybytes, int& myhotblocks, float& tfwt, float& tencode)
+	{
+		typedef WaveletsOnInterval::FullTransformBatch<_BLOCKSIZE_> TransformBatch;
+
+		enum { K = TransformBatch::K };
+
+		TransformBatch * const batch = TransformBatch::create();
+		vector<Real> blocks(wchannels * K * NPTS);
+		vector<Real *> blockptr(wchannels * K);	// channel c of block k at c * K + k
+		for(int k = 0; k < wchannels * K; ++k)
+			blockptr[k] = &blocks[k * NPTS];
+
+		WaveletCompressor * const compressor = new WaveletCompressor;
+		compressor->set_sigmap(this->sigmap);
+		compressor->set_quantizer(this->quantizer);
+		compressor->set_shuffle(this->shuffle);
+		compressor->set_zerobits(this->zerobits);
+
+		const int NBATCHES = (NBLOCKS + K - 1) / K;
+
+		// the chunks of a thread must be the same in the two passes of streaming
+#pragma omp for schedule(static)
+		for(int ibatch = 0; ibatch < NBATCHES; ++ibatch)
+		{
+			const int first = ibatch * K;
+			const int nb = std::min((int)K, NBLOCKS - first);
 
-					const int inbytes = FluidBlock::sizeX * FluidBlock::sizeY * FluidBlock::sizeZ * sizeof(Real);
-					int nbytes = inbytes;
+			Timer tw; tw.start();
+
+			for(int c = 0; c < wchannels; ++c)
+			{
+				Real ** const ptr = &blockptr[c * K];
+
+				for(int k = 0; k < nb; ++k)
+					_fill_any<0>(_channel(channel, c), vInfo[first + k], streamer, ptr[k]);
+
+				batch->pack(ptr, nb);
+				batch->fwt(this->wtype_write);
+				batch->unpack(ptr, nb);
+			}
+
+			tfwt += tw.stop();
+
+			for(int k = 0; k < nb; ++k)
+			{
+				const int i = first + k;
+
+				tw.start();
+
+				//wavelet digestion
+				for(int c = 0; c < wchannels; ++c)
+				{
+					memcpy(&compressor->uncompressed_data()[0][0][0], blockptr[c * K + k], sizeof(Real) * NPTS);
+
+					const int nbytes = (int)compressor->compress_coefficients(this->threshold, this->halffloat);
 					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
 					mybytes += sizeof(nbytes);
 
-#if defined(_USE_ZEROBITS_)
-					// set some bits to zero
-					for(int iz=0; iz<FluidBlock::sizeZ; iz++)
-					for(int iy=0; iy<FluidBlock::sizeY; iy++)
-					for(int ix=0; ix<FluidBlock::sizeX; ix++)
-						float_zero_bits((unsigned int *)&mysoabuffer[ix + _BLOCKSIZE_ * (iy + _BLOCKSIZE_ * iz)], _ZEROBITS_);
-#endif
-
-					memcpy(mybuf.compressedbuffer + mybytes, mysoabuffer, sizeof(unsigned char) * nbytes);
-#endif
+					memcpy(mybuf.compressedbuffer + mybytes, compressor->compressed_data(), sizeof(unsigned char) * nbytes);
 					mybytes += nbytes;
 				}
 
@@ -332,11 +446,78 @@ protected:
 				}
 
 				if (mybytes >= ALERT || myhotblocks >= ENTRIES)
-					tencode = _encode_and_flush(mybuf.compressedbuffer, mybytes, (long)BUFFERSIZE, mybuf.hotblocks, myhotblocks);
+					tencode = _encode_and_flush(mybuf.compressedbuffer, mybytes, (long)sizeof(mybuf.compressedbuffer), mybuf.hotblocks, myhotblocks);
+			}
+		}
+
+		delete compressor;
+		TransformBatch::destroy(batch);
+	}
+
+	template<int channel>
+	void _compress(const vector<BlockInfo>& vInfo, const int NBLOCKS, IterativeStreamer streamer)
+	{
+		int compress_threads = omp_get_max_threads();
+		if (compress_threads < 1) compress_threads = 1;
+
+#pragma omp parallel 
+		{
+		  const int tid = omp_get_thread_num();
+
+		  CompressionBuffer & mybuf = workbuffer[tid];
+
+			long mybytes = 0; int myhotblocks = 0;
+
+			float tfwt = 0, tencode = 0;
+			Timer timer;
+			timer.start();
+
+			if (codec == BlockCodecs::wavz)
+				_compress_batched<channel>(vInfo, NBLOCKS, streamer, mybuf, mybytes, myhotblocks, tfwt, tencode);
+			else
+			{
+			BlockCodecs::Settings settings(codec);
+			settings.threshold = this->threshold;
+			settings.shuffle = this->shuffle;
+			settings.zerobits = this->zerobits;
+
+			BlockCodec * const blockcodec = BlockCodecs::create(settings);
+			vector<Real> mysoabuffer(NPTS);
+
+			// the chunks of a thread must be the same in the two passes of streaming
+#pragma omp for schedule(static)
+			for(int i = 0; i < NBLOCKS; ++i)
+			{
+				Timer tw; tw.start();
+
+				//first stage
+				for(int c = 0; c < wchannels; ++c)
+				{
+					_fill_any<0>(_channel(channel, c), vInfo[i], streamer, &mysoabuffer.front());
+
+					const int nbytes = blockcodec->compress(&mysoabuffer.front(), mybuf.compressedbuffer + mybytes + sizeof(int));
+					memcpy(mybuf.compressedbuffer + mybytes, &nbytes, sizeof(nbytes));
+					mybytes += sizeof(nbytes) + nbytes;
+				}
+
+				tfwt += tw.stop();
+
+				//building the meta data
+				{
+					BlockMetadata curr = { i, myhotblocks, vInfo[i].index[0], vInfo[i].index[1], vInfo[i].index[2]};
+					mybuf.hotblocks[myhotblocks] = curr;
+					myhotblocks++;
+				}
+
+				if (mybytes >= ALERT || myhotblocks >= ENTRIES)
+					tencode = _encode_and_flush(mybuf.compressedbuffer, mybytes, (long)sizeof(mybuf.compressedbuffer), mybuf.hotblocks, myhotblocks);
+			}
+
+			delete blockcodec;
 			}
 
 			if (mybytes > 0)
-				tencode = _encode_and_flush(mybuf.compressedbuffer, mybytes, (long)BUFFERSIZE, mybuf. hotblocks, myhotblocks);
+				tencode = _encode_and_flush(mybuf.compressedbuffer, mybytes, (long)sizeof(mybuf.compressedbuffer), mybuf.hotblocks, myhotblocks);
 
 			workload_total[tid] = timer.stop();
 			workload_fwt[tid] = tfwt;
@@ -344,13 +525,8 @@ protected:
 		}
 	}
 
-	virtual void _to_file(const MPI_Comm mycomm, const string fileName)
+	MPI_File _open(const MPI_Comm mycomm, const string fileName)
 	{
-		int mygid;
-		int nranks;
-		MPI_Comm_rank(mycomm, &mygid);
-		MPI_Comm_size(mycomm, &nranks);
-
 		MPI_Info myfileinfo;
 		MPI_Info_create(&myfileinfo);
 
@@ -362,41 +538,140 @@ protected:
 #if defined(_WRITE_AT_ALL_)
 		MPI_File_open(mycomm, (char*)fileName.c_str(),  MPI_MODE_WRONLY | MPI_MODE_CREATE, myfileinfo, &myfile);
 #else
+		(void)mycomm;	// avoid warnings, each rank opens the file alone
 		MPI_File_open(MPI_COMM_SELF, (char*)fileName.c_str(),  MPI_MODE_WRONLY | MPI_MODE_CREATE, myfileinfo, &myfile);
 #endif
 		MPI_Info_free(&myfileinfo);
 
-		size_t current_displacement = 0;
+		return myfile;
+	}
 
-		//write the mini-header
+	/* start of my data after the mini-header: the data of the lower ranks comes first */
+	size_t _data_offset(const MPI_Comm mycomm, const size_t mybytes)
+	{
+		// apparently this suck:
+		// myfile.Seek_shared(current_displacement, MPI_SEEK_SET);
+		// myfile.Write_ordered(&allmydata.front(), written_bytes, MPI_CHAR);
+		// current_displacement = myfile.Get_position_shared();
+		// so here we do it manually. so nice!
+
+		int mygid;
+		MPI_Comm_rank(mycomm, &mygid);
+
+		size_t myfileoffset = 0;
+		MPI_Exscan((void *)&mybytes, &myfileoffset, 1, MPI_UINT64_T, MPI_SUM, mycomm);
+
+		if (mygid == 0)
+			myfileoffset = 0;
+
+		return myfileoffset;
+	}
+
+	size_t _miniheader_bytes() const { return sizeof(size_t) + binaryocean_title.size(); }
+
+	/* streaming, first pass: the bytes of my data from a compression that stores nothing,
+	   then the file is opened and the second pass writes the slabs as they fill */
+	template<int channel>
+	void _open_stream(const vector<BlockInfo>& vInfo, IterativeStreamer streamer, const MPI_Comm mycomm, const string fileName)
+	{
+		// the slabs are written by the thread that completes them
+		int provided;
+		MPI_Query_thread(&provided);
+		if (omp_get_max_threads() > 1 && provided < MPI_THREAD_SERIALIZED)
 		{
-			size_t blank_address = -1;
+			printf("SerializerIO_WaveletCompression_MPI_Simple.h: streaming with threads needs MPI_THREAD_SERIALIZED!!\n");
+			abort();
+		}
 
-			const int miniheader_bytes = sizeof(blank_address) + binaryocean_title.size();
+		sizing = true;
+		_compress<channel>(vInfo, vInfo.size(), streamer);
+		sizing = false;
 
-			current_displacement += miniheader_bytes;
+		size_t nchunks = 0;
+		for(size_t t = 0; t < thread_luts.size(); ++t)
+		{
+			nchunks += thread_luts[t].size();
+			thread_luts[t].clear();
 		}
 
+		WriteBehind& wb = writebehind;
+		wb.bytes = written_bytes + nchunks * sizeof(size_t);
+		wb.offset = recordbase + _miniheader_bytes() + _data_offset(mycomm, wb.bytes);
+		wb.posted = 0;
+		wb.file = _open(mycomm, fileName);
+
+		written_bytes = 0;
+	}
+
+	/* appending to a container: rank 0 reads its index, the record starts at its end */
+	void _find_record(const MPI_Comm mycomm, const string fileName)
+	{
+		int mygid;
+		MPI_Comm_rank(mycomm, &mygid);
+
+		if (mygid == 0)
+		{
+			if (!Container::read(fileName, cindex))
+			{
+				printf("SerializerIO_WaveletCompression_MPI_Simple.h: %s is not a container!!\n", fileName.c_str());
+				abort();
+			}
+
+			recordbase = cindex.end;
+		}
+
+		MPI_Bcast(&recordbase, 1, MPI_UINT64_T, 0, mycomm);
+	}
+
+	virtual void _to_file(const MPI_Comm mycomm, const string fileName)
+	{
+		int mygid;
+		int nranks;
+		MPI_Comm_rank(mycomm, &mygid);
+		MPI_Comm_size(mycomm, &nranks);
+
+		// the data is there already if it was streamed
+		const bool streamed = writebehind.file != MPI_FILE_NULL;
+		MPI_File myfile = streamed ? writebehind.file : _open(mycomm, fileName);
+
+		size_t current_displacement = recordbase;
+
+		//write the mini-header
+		current_displacement += _miniheader_bytes();
+
 		//write the buffer - alias the binary ocean
 		{
-			// apparently this suck:
-			// myfile.Seek_shared(current_displacement, MPI_SEEK_SET);
-			// myfile.Write_ordered(&allmydata.front(), written_bytes, MPI_CHAR);
-			// current_displacement = myfile.Get_position_shared();
-			// so here we do it manually. so nice!
+			const size_t myfileoffset = _data_offset(mycomm, written_bytes);
 
-			size_t myfileoffset = 0;
-			MPI_Exscan(&written_bytes, &myfileoffset, 1, MPI_UINT64_T, MPI_SUM, mycomm);
+			// the slabs of allmydata and then lut_compression, in one call
+			if (!streamed)
+			{
+				const size_t databytes = written_bytes - lut_compression.size() * sizeof(size_t);
 
-			if (mygid == 0)
-				myfileoffset = 0;
+				const int nslabs = allmydata.count(databytes);
+				vector<int> slabbytes(nslabs + 1);
+				vector<MPI_Aint> slabaddresses(nslabs + 1);
+				for(int k = 0; k < nslabs; ++k)
+				{
+					slabbytes[k] = allmydata.bytes(k, databytes);
+					MPI_Get_address(allmydata.slab(k), &slabaddresses[k]);
+				}
 
-			MPI_Status status;
+				slabbytes[nslabs] = lut_compression.size() * sizeof(size_t);
+				MPI_Get_address(lut_compression.data(), &slabaddresses[nslabs]);
+
+				MPI_Datatype slabtype;
+				MPI_Type_create_hindexed(nslabs + 1, &slabbytes.front(), &slabaddresses.front(), MPI_CHAR, &slabtype);
+				MPI_Type_commit(&slabtype);
+
+				MPI_Status status;
 #if defined(_WRITE_AT_ALL_)
-			MPI_File_write_at_all(myfile, current_displacement + myfileoffset, &allmydata.front(), written_bytes, MPI_CHAR, &status);
+				MPI_File_write_at_all(myfile, current_displacement + myfileoffset, MPI_BOTTOM, 1, slabtype, &status);
 #else
-			MPI_File_write_at(myfile, current_displacement + myfileoffset, &allmydata.front(), written_bytes, MPI_CHAR, &status);
+				MPI_File_write_at(myfile, current_displacement + myfileoffset, MPI_BOTTOM, 1, slabtype, &status);
 #endif
+				MPI_Type_free(&slabtype);
+			}
 
 			//here we update current_displacement by broadcasting the total written bytes from rankid = nranks -1
 			size_t total_written_bytes = myfileoffset + written_bytes;
@@ -408,9 +683,12 @@ protected:
 		//go back at the blank address and fill it with the displacement
 		if (mygid == 0)
 		{
+			// relative to the record
+			const size_t header_displacement = current_displacement - recordbase;
+
 			MPI_Status status;
-			MPI_File_write(myfile, &current_displacement, sizeof(current_displacement), MPI_CHAR, &status);
-			MPI_File_write(myfile, (void*)binaryocean_title.c_str(), binaryocean_title.size(), MPI_CHAR, &status);
+			MPI_File_write_at(myfile, recordbase, (void*)&header_displacement, sizeof(header_displacement), MPI_CHAR, &status);
+			MPI_File_write_at(myfile, recordbase + sizeof(header_displacement), (void*)binaryocean_title.c_str(), binaryocean_title.size(), MPI_CHAR, &status);
 		}
 
 		//write the header
@@ -450,8 +728,6 @@ protected:
 
 		//write the local buffer entries
 		{
-			assert(lut_compression.size() == 0);
-
 			const int lutheader_bytes = sizeof(lutheader);
 
 			MPI_Status status;
@@ -460,9 +736,40 @@ protected:
 #else
 			MPI_File_write_at(myfile, current_displacement + mygid * lutheader_bytes, &lutheader, lutheader_bytes, MPI_CHAR, &status);
 #endif
+			current_displacement += lutheader_bytes * nranks;
+		}
+
+		//the record goes to the index of the container
+		vector<Container::Write> cwrites;
+		if (cstep >= 0 && mygid == 0)
+		{
+			cwrites = Container::append(cindex, Container::entry(recordbase, current_displacement - recordbase, cstep, cfield));
+
+			MPI_Status status;
+			for(size_t i = 0; i + 1 < cwrites.size(); ++i)
+				MPI_File_write_at(myfile, cwrites[i].offset, &cwrites[i].bytes.front(), cwrites[i].bytes.size(), MPI_CHAR, &status);
 		}
 
 		MPI_File_close(&myfile); //bon voila tu vois ou quoi
+		writebehind.file = MPI_FILE_NULL;
+		lut_compression.clear();
+
+		//and the superblock, once all the rest is in the file
+		if (cstep >= 0)
+		{
+			MPI_Barrier(mycomm);
+
+			if (mygid == 0)
+			{
+				const Container::Write& w = cwrites.back();
+
+				MPI_File_open(MPI_COMM_SELF, (char*)fileName.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &myfile);
+
+				MPI_Status status;
+				MPI_File_write_at(myfile, w.offset, (void*)&w.bytes.front(), w.bytes.size(), MPI_CHAR, &status);
+				MPI_File_close(&myfile);
+			}
+		}
 	}
 
 	float _profile_report(const char * const workload_name, vector<float>& workload, const MPI_Comm mycomm, bool isroot)
@@ -530,72 +837,83 @@ protected:
 				ss << "Blocks: " << xtotalbpd << " x "  << ytotalbpd << " x " << ztotalbpd  << "\n";
 				ss << "Extent: " << xExtent << " " << yExtent << " " << zExtent << "\n";
 				ss << "SubdomainBlocks: " << xbpd << " x "  << ybpd << " x " << zbpd  << "\n";
-				ss << "HalfFloat: " << (this->halffloat ? "yes" : "no") << "\n";
-#if defined(_USE_WAVZ_)
-				ss << "Wavelets: " << WaveletsOnInterval::ChosenWavelets_GetName(this->wtype_write) << "\n";
-#elif defined(_USE_FPZIP_)
-				ss << "Wavelets: " << "fpzip" << "\n";
-#elif defined(_USE_ZFP_)
-				ss << "Wavelets: " << "zfp" << "\n";
-#elif defined(_USE_SZ_)
-				ss << "Wavelets: " << "sz" << "\n";
-#else
-				ss << "Wavelets: " << "none" << "\n";
-#endif
+				const bool wavz = this->codec == BlockCodecs::wavz;
+
+				ss << "HalfFloat: " << HalfFloat::name(wavz ? this->halffloat : HalfFloat::none) << "\n";
+				ss << "Wavelets: " << BlockCodecs::name(this->codec, this->wtype_write) << "\n";
 				ss << "WaveletThreshold: " << threshold << "\n";
-#if defined(_USE_ZLIB_)
-				ss << "Encoder: " << "zlib" << "\n";
-#elif defined(_USE_LZ4_)
-                                ss << "Encoder: " << "lz4" << "\n";
-#else
-                                ss << "Encoder: " << "none" << "\n";
-#endif
+				if (wavz && this->sigmap != SignificanceMap::bitset)
+					ss << "SignificanceMap: " << SignificanceMap::name(this->sigmap) << "\n";
+				if (wavz && this->quantizer != BitPlane::none)
+					ss << "Quantization: " << BitPlane::name(this->quantizer) << "\n";
+				if (this->shuffle != Shuffle::none || (int)Shuffle::DEFAULT != Shuffle::none)
+					ss << "Filter: " << Shuffle::name(this->shuffle) << "\n";
+				if (wchannels > 1)
+					ss << "Channels: " << wchannels << "\n";
+				ss << "Encoder: " << Encoder::name(encoder.format) << "\n";
 				ss << "==============START-BINARY-METABLOCKS==============\n";
 
 				this->header = ss.str();
 			}
 		}
 
+		const MPI_Comm mycomm = inputGrid.getCartComm();
+		const bool stream = streaming && getenv("CUBISMZ_NOIO") == NULL;
+
+		recordbase = 0;
+		if (cstep >= 0 && getenv("CUBISMZ_NOIO") == NULL)
+			_find_record(mycomm, fileName);
+
 		//compress my data, prepare for serialization
 		{
 			double t0 = MPI_Wtime();
-			written_bytes = pending_writes = completed_writes = 0;
-
-			if (allmydata.size() == 0)
-			{
-				//const size_t speculated_compression_rate = 10;
-				allmydata.resize(NBLOCKS * sizeof(Real) * NPTS + 4*1024*1024);
-			}
+			written_bytes = 0;
+			allmydata.rewind();
 
 			myblockindices.clear();
 			myblockindices.resize(NBLOCKS);
 
 			lut_compression.clear();
 
+			if (stream)
+				_open_stream<channel>(infos, streamer, mycomm, fileName);
+
 			_compress<channel>(infos, infos.size(), streamer);
 
-			//manipulate the file data (allmydata, lut_compression, myblockindices)
-			//so that they are file-friendly
+			_merge_luts();
+
+			//lut_compression follows allmydata in the file, it is written from where it is
 			{
 				const int nchunks = lut_compression.size();
 				const size_t extrabytes = lut_compression.size() * sizeof(size_t);
-				const char * const lut_ptr = (char *)&lut_compression.front();
 
-				allmydata.insert(allmydata.begin() + written_bytes, lut_ptr, lut_ptr + extrabytes);
-				lut_compression.clear();
+				if (stream)
+				{
+					// the two passes must agree, or the ranks overwrite each other
+					if (written_bytes + extrabytes != writebehind.bytes)
+					{
+						printf("SerializerIO_WaveletCompression_MPI_Simple.h: streaming, %ld bytes instead of %ld!!\n", (long)(written_bytes + extrabytes), (long)writebehind.bytes);
+						abort();
+					}
+
+					_write_behind(true);
+
+					MPI_Status status;
+					MPI_File_write_at(writebehind.file, writebehind.offset + written_bytes, lut_compression.data(), extrabytes, MPI_CHAR, &status);
+				}
 
 				HeaderLUT newvalue = { written_bytes + extrabytes, nchunks };
 				lutheader = newvalue;
 
 				written_bytes += extrabytes;
 			}
+
 			double t1 = MPI_Wtime();
 			printf("SerializerIO_WaveletCompression_MPI_Simple.h: compress+serialization %f seconds\n", t1-t0); 
 		}
 
 		double io_t0 = MPI_Wtime();
 		///
-		const MPI_Comm mycomm = inputGrid.getCartComm();
 		int mygid;
 		int comm_size;
 		MPI_Comm_rank(mycomm, &mygid);
@@ -702,17 +1020,37 @@ protected:
 				fscanf(file, "SubdomainBlocks: %d x %d x %d\n", bpd, bpd + 1, bpd + 2);
 
 				fscanf(file, "HalfFloat: %s\n", buf);
-				this->halffloat = (string(buf) == "yes");
+				this->halffloat = HalfFloat::parse_header(buf);
+				assert(this->halffloat >= 0);
 
 				fscanf(file, "Wavelets: %s\n", buf);
-				assert(buf == string(WaveletsOnInterval::ChosenWavelets_GetName(this->wtype_read)));
+				this->codec = BlockCodecs::parse(buf, this->wtype_read);
+				assert(BlockCodecs::available(this->codec));
+
+				float mythreshold = -1;
+				fscanf(file, "WaveletThreshold: %f\n", &mythreshold);
+				this->threshold = mythreshold;
+
+				// optional, older files have bitset masks
+				this->sigmap = SignificanceMap::bitset;
+				if (fscanf(file, "SignificanceMap: %s\n", buf) == 1)
+					this->sigmap = SignificanceMap::parse(buf);
+				assert(this->sigmap >= 0);
+
+				this->quantizer = BitPlane::none;
+				if (fscanf(file, "Quantization: %s\n", buf) == 1)
+					this->quantizer = BitPlane::parse(buf);
+				assert(this->quantizer >= 0);
+
+				// optional, older files have the shuffle of the build
+				this->shuffle = Shuffle::DEFAULT;
+				if (fscanf(file, "Filter: %s\n", buf) == 1)
+					this->shuffle = Shuffle::parse(buf);
+				assert(this->shuffle >= 0);
 
 				fscanf(file, "Encoder: %s\n", buf);
-#if defined(_USE_ZLIB_)
-				assert(buf == string("zlib"));
-#else	/* _USE_LZ4_ */
-				assert(buf == string("lz4"));
-#endif
+				this->encoder.format = Encoder::parse(buf);
+				assert(Encoder::available(this->encoder.format));
 
 
 				fgets(buf, sizeof(buf), file);
@@ -860,7 +1198,7 @@ protected:
 
 
 			vector<unsigned char> waveletbuf(4 << 20);
-			const size_t decompressedbytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size());
+			const size_t decompressedbytes = zdecompress(&compressedbuf.front(), compressedbuf.size(), &waveletbuf.front(), waveletbuf.size(), encoder.format);
 			int readbytes = 0;
 			for(int i = 0; i<compressedchunk.subid; ++i)
 			{
@@ -880,11 +1218,19 @@ protected:
 				readbytes += sizeof(int);
 				assert(readbytes <= decompressedbytes);
 
-				WaveletCompressor compressor;
-				memcpy(compressor.compressed_data(), &waveletbuf[readbytes], nbytes);
+				BlockCodecs::Settings settings(codec);
+				settings.threshold = threshold;
+				settings.wtype = wtype_read;
+				settings.halffloat = halffloat;
+				settings.sigmap = sigmap;
+				settings.quantizer = quantizer;
+				settings.shuffle = shuffle;
+
+				BlockCodec * const blockcodec = BlockCodecs::create(settings);
+				blockcodec->decompress(&waveletbuf[readbytes], nbytes, &MYBLOCK[0][0][0]);
 				readbytes += nbytes;
 
-				compressor.decompress(halffloat, nbytes, wtype_read, MYBLOCK);
+				delete blockcodec;
 			}
 
 			for(int iz = 0; iz< _BLOCKSIZE_; ++iz)
@@ -903,18 +1249,45 @@ public:
 	void set_wtype_write(const int wtype) { this->wtype_write = wtype; }
 	void set_wtype_read(const int wtype) { this->wtype_read = wtype; }
 
-	void float16() { halffloat = true; }
+	// reduced precision of the wavelet survivors (see HalfFloat.h)
+	void float16(const int format = HalfFloat::fp16) { halffloat = format; }
+
+	// coding of the significance maps of the wavelet survivors (see SignificanceMap.h)
+	void set_sigmap(const int format) { sigmap = format; }
+
+	// quantization of the wavelet survivors (see BitPlane.h), it takes the place of halffloat
+	void set_quantizer(const int format) { quantizer = format; }
+
+	// the filter between the two stages (see Shuffle.h)
+	void set_shuffle(const int format) { shuffle = format; }
+
+	// bits of the mantissa set to zero before the second stage (see ZeroBits.h)
+	void set_zerobits(const ZeroBits::Settings& settings) { zerobits = settings; }
+
+	void set_encoder(const Encoder::Settings& settings) { encoder = settings; }
+
+	// the first stage (see BlockCodecs.h)
+	void set_codec(const int kind) { codec = kind; }
+
+	// compression in two passes, the second one writes the data to the file while it compresses
+	void set_streaming(const bool streaming) { this->streaming = streaming; }
+
+	// the dumps are appended to the file as the record of step and field (see Container.h),
+	// a step < 0 writes files of their own
+	void set_record(const int step, const string field) { cstep = step; cfield = field; }
 
 	void verbose() { verbosity = true; }
 
 	SerializerIO_WaveletCompression_MPI_SimpleBlocking():
-	written_bytes(0), pending_writes(0),
-	threshold(0), halffloat(false), verbosity(false),
+	thread_luts(omp_get_max_threads()), written_bytes(0), streaming(false), sizing(false), cstep(-1), recordbase(0),
+	threshold(0), halffloat(HalfFloat::none), sigmap(SignificanceMap::bitset), quantizer(BitPlane::none), codec(BlockCodecs::DEFAULT), shuffle(Shuffle::DEFAULT), wchannels(1), verbosity(false),
 	workload_total(omp_get_max_threads()), workload_fwt(omp_get_max_threads()), workload_encode(omp_get_max_threads()),
 	workbuffer(omp_get_max_threads())
 	{
 		wtype_write = 1;	// peh
 		wtype_read = 1;		// peh
+
+		writebehind.file = MPI_FILE_NULL;
 	}
 
 	template< int channel >
@@ -925,7 +1298,34 @@ public:
 		if (channel > 0)
 			ss << "." << streamer.name() << ".ch"  << channel;
 
-		_write<channel>(inputGrid, fileName + ss.str(), streamer);
+		wchannels = 1;
+
+		// in a container, the channel tells the records apart instead of the files
+		if (cstep >= 0)
+		{
+			const string field = cfield;
+			cfield += ss.str();
+			_write<channel>(inputGrid, fileName, streamer);
+			cfield = field;
+		}
+		else
+			_write<channel>(inputGrid, fileName + ss.str(), streamer);
+	}
+
+	/* all the channels in one file, in one pass over the grid: the channels of a block are in
+	   the same chunk, one after the other ("Channels:" in the header) */
+	void Write_interleaved(GridType & inputGrid, string fileName, IterativeStreamer streamer = IterativeStreamer())
+	{
+		// a block of all the channels must fit in the half of the chunk buffer beyond ALERT
+		if (NCHANNELS > ENTRIES + 1)
+		{
+			printf("SerializerIO_WaveletCompression_MPI_Simple.h: %d channels, at most %d interleaved!!\n", (int)NCHANNELS, (int)ENTRIES + 1);
+			abort();
+		}
+
+		wchannels = NCHANNELS;
+		_write<0>(inputGrid, fileName, streamer);
+		wchannels = 1;
 	}
 
 	void Read(string fileName, IterativeStreamer streamer = IterativeStreamer())
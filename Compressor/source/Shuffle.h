@@ -0,0 +1,302 @@
+/*
+ * Shuffle.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _SHUFFLE_H_
+#define _SHUFFLE_H_ 1
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* pre-filters of the second stage ("Filter:" in the header: unlike "Shuffle:", no other
+   optional entry starts with its letter, and the fscanf of an entry eats what matches),
+   on the survivors of the wavelets or on the output of the other codecs. n bytes of
+   elements of esize bytes:
+
+	byte:	byte 0 of all the elements, then byte 1, ... (as the old shuffle3)
+	bit:	the bytes shuffled, then each byte plane as 8 bit planes, most significant
+		first, one bit per element (as bitshuffle)
+
+   the bytes of the last n % esize, and for bit those of the last elements % 8, are kept
+   as they are at the end */
+namespace Shuffle
+{
+	enum Format { none = 0, byte = 1, bit = 2 };
+
+#if defined(_USE_SHUFFLE3_)
+	enum { DEFAULT = byte };
+#else
+	enum { DEFAULT = none };
+#endif
+
+	inline const char * name(const int format)
+	{
+		if (format == byte) return "byte";
+		if (format == bit) return "bit";
+		return "no";
+	}
+
+	/* -1 if unknown */
+	inline int parse(const std::string s)
+	{
+		if (s == "no") return none;
+		if (s == "byte") return byte;
+		if (s == "bit") return bit;
+		return -1;
+	}
+
+	/* scratch of the calling thread, grown to the largest input */
+	inline unsigned char * _scratch(const int n)
+	{
+		static thread_local std::vector<unsigned char> buf;
+
+		if ((int)buf.size() < n)
+			buf.resize(n);
+
+		return &buf.front();
+	}
+
+#if defined(__SSE2__)
+	/* 16 elements of S bytes (S = 2, 4 or 8) in S registers, transposed in 4 rounds:
+	   a round interleaves the registers that differ in one bit of their index */
+	template<int S>
+	inline void _transpose16(__m128i v[S])
+	{
+		enum { LOGS = S == 2 ? 1 : S == 4 ? 2 : 3 };
+
+		for(int r = 0; r < 4; ++r)
+		{
+			const int t = 1 << (LOGS - 1 - r % LOGS);
+
+			for(int w = 0; w < S; ++w)
+				if (!(w & t))
+				{
+					const __m128i x = v[w], y = v[w | t];
+					v[w] = _mm_unpacklo_epi8(x, y);
+					v[w | t] = _mm_unpackhi_epi8(x, y);
+				}
+		}
+	}
+
+	template<int S>
+	inline void _untranspose16(__m128i v[S])
+	{
+		enum { LOGS = S == 2 ? 1 : S == 4 ? 2 : 3 };
+
+		const __m128i lobytes = _mm_set1_epi16(0x00ff);
+
+		for(int r = 3; r >= 0; --r)
+		{
+			const int t = 1 << (LOGS - 1 - r % LOGS);
+
+			for(int w = 0; w < S; ++w)
+				if (!(w & t))
+				{
+					const __m128i lo = v[w], hi = v[w | t];
+					v[w] = _mm_packus_epi16(_mm_and_si128(lo, lobytes), _mm_and_si128(hi, lobytes));
+					v[w | t] = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+				}
+		}
+	}
+
+	/* the register that holds byte b after _transpose16 */
+	template<int S>
+	inline int _plane(const int b)
+	{
+		return S == 8 ? ((b & 1) << 2) | (b >> 1) : b;
+	}
+
+	template<int S>
+	inline int _bytes_sse2(const unsigned char * const in, const int nelements, unsigned char * const out)
+	{
+		const int n16 = nelements & ~15;
+
+		for(int i = 0; i < n16; i += 16)
+		{
+			__m128i v[S];
+			for(int w = 0; w < S; ++w)
+				v[w] = _mm_loadu_si128((const __m128i *)(in + i * S + 16 * w));
+
+			_transpose16<S>(v);
+
+			for(int b = 0; b < S; ++b)
+				_mm_storeu_si128((__m128i *)(out + b * nelements + i), v[_plane<S>(b)]);
+		}
+
+		return n16;
+	}
+
+	template<int S>
+	inline int _unbytes_sse2(const unsigned char * const in, const int nelements, unsigned char * const out)
+	{
+		const int n16 = nelements & ~15;
+
+		for(int i = 0; i < n16; i += 16)
+		{
+			__m128i v[S];
+			for(int b = 0; b < S; ++b)
+				v[_plane<S>(b)] = _mm_loadu_si128((const __m128i *)(in + b * nelements + i));
+
+			_untranspose16<S>(v);
+
+			for(int w = 0; w < S; ++w)
+				_mm_storeu_si128((__m128i *)(out + i * S + 16 * w), v[w]);
+		}
+
+		return n16;
+	}
+#endif
+
+	/* byte shuffle of nelements elements from in to out */
+	inline void _bytes(const unsigned char * const in, const int nelements, const int esize, unsigned char * const out)
+	{
+		int i0 = 0;
+#if defined(__SSE2__)
+		if (esize == 2) i0 = _bytes_sse2<2>(in, nelements, out);
+		if (esize == 4) i0 = _bytes_sse2<4>(in, nelements, out);
+		if (esize == 8) i0 = _bytes_sse2<8>(in, nelements, out);
+#endif
+		for(int b = 0; b < esize; ++b)
+			for(int i = i0; i < nelements; ++i)
+				out[b * nelements + i] = in[i * esize + b];
+	}
+
+	inline void _unbytes(const unsigned char * const in, const int nelements, const int esize, unsigned char * const out)
+	{
+		int i0 = 0;
+#if defined(__SSE2__)
+		if (esize == 2) i0 = _unbytes_sse2<2>(in, nelements, out);
+		if (esize == 4) i0 = _unbytes_sse2<4>(in, nelements, out);
+		if (esize == 8) i0 = _unbytes_sse2<8>(in, nelements, out);
+#endif
+		for(int i = i0; i < nelements; ++i)
+			for(int b = 0; b < esize; ++b)
+				out[i * esize + b] = in[b * nelements + i];
+	}
+
+	/* n bytes (n % 8 == 0) into 8 planes of n / 8 bytes, bit 7 first */
+	inline void _bits(const unsigned char * const in, const int n, unsigned char * const out)
+	{
+		const int planebytes = n / 8;
+		int i = 0;
+#if defined(__SSE2__)
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+			for(int p = 0; p < 8; ++p)
+			{
+				const unsigned short m = _mm_movemask_epi8(v);
+				memcpy(out + p * planebytes + i / 8, &m, sizeof(m));
+				v = _mm_add_epi8(v, v);
+			}
+		}
+#endif
+		for(; i < n; i += 8)
+			for(int p = 0; p < 8; ++p)
+			{
+				unsigned int m = 0;
+				for(int l = 0; l < 8; ++l)
+					m |= (in[i + l] >> (7 - p) & 1u) << l;
+
+				out[p * planebytes + i / 8] = m;
+			}
+	}
+
+	inline void _unbits(const unsigned char * const in, const int n, unsigned char * const out)
+	{
+		const int planebytes = n / 8;
+		int i = 0;
+#if defined(__SSE2__)
+		const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i v = _mm_setzero_si128();
+
+			for(int p = 0; p < 8; ++p)
+			{
+				unsigned short m;
+				memcpy(&m, in + p * planebytes + i / 8, sizeof(m));
+
+				// byte l of the register gets bit l % 8 of byte l / 8 of m
+				__m128i x = _mm_cvtsi32_si128(m);
+				x = _mm_unpacklo_epi8(x, x);
+				x = _mm_unpacklo_epi16(x, x);
+				x = _mm_unpacklo_epi32(x, x);
+				x = _mm_cmpeq_epi8(_mm_and_si128(x, bits), bits);
+
+				v = _mm_or_si128(v, _mm_and_si128(x, _mm_set1_epi8((char)(0x80 >> p))));
+			}
+
+			_mm_storeu_si128((__m128i *)(out + i), v);
+		}
+#endif
+		for(; i < n; i += 8)
+			for(int l = 0; l < 8; ++l)
+			{
+				unsigned int c = 0;
+				for(int p = 0; p < 8; ++p)
+					c |= (in[p * planebytes + i / 8] >> l & 1u) << (7 - p);
+
+				out[i + l] = c;
+			}
+	}
+
+	/* the elements filtered by the format: all of them for byte, a multiple of 8 for bit */
+	inline int _elements(const int format, const int n, const int esize)
+	{
+		const int nelements = n / esize;
+		return format == bit ? nelements & ~7 : nelements;
+	}
+
+	/* buf[0..n-1] filtered in place */
+	inline void encode(const int format, unsigned char * const buf, const int n, const int esize)
+	{
+		const int nelements = _elements(format, n, esize);
+
+		if (format == none || nelements == 0) return;
+
+		unsigned char * const tmp = _scratch(nelements * esize);
+
+		_bytes(buf, nelements, esize, tmp);
+
+		if (format == bit)
+			for(int b = 0; b < esize; ++b)
+				_bits(tmp + b * nelements, nelements, buf + b * nelements);
+		else
+			memcpy(buf, tmp, nelements * esize);
+	}
+
+	inline void decode(const int format, unsigned char * const buf, const int n, const int esize)
+	{
+		const int nelements = _elements(format, n, esize);
+
+		if (format == none || nelements == 0) return;
+
+		unsigned char * const tmp = _scratch(nelements * esize);
+
+		if (format == bit)
+			for(int b = 0; b < esize; ++b)
+				_unbits(buf + b * nelements, nelements, tmp + b * nelements);
+		else
+			memcpy(tmp, buf, nelements * esize);
+
+		_unbytes(tmp, nelements, esize, buf);
+	}
+}
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * SignificanceMap.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _SIGNIFICANCEMAP_H_
+#define _SIGNIFICANCEMAP_H_ 1
+
+#pragma once
+
+#include <cstring>
+#include <string>
+
+/* coding of the significance map of a block ("SignificanceMap:" in the header).
+   bitset: the (BS^3 + 7) / 8 mask bytes as they are.
+   octree: the mask cube is split recursively in octants, pre-order, one bit per octant
+   (0: no survivor in it, nothing more is stored), down to 2^3 leaves of 8 raw bits.
+   the subbands of FullTransformEngine are octants of the mask, an empty subband of any
+   level costs one bit. the octants holding the 4^3 scaling coefficients are always
+   significant and cost nothing, and the last of 8 octants is not stored when the first
+   7 are empty and the parent is known to be significant */
+namespace SignificanceMap
+{
+	enum Format { bitset = 0, octree = 1 };
+
+	inline const char * name(const int format)
+	{
+		return format == octree ? "octree" : "bitset";
+	}
+
+	/* -1 if unknown */
+	inline int parse(const std::string s)
+	{
+		if (s == "bitset") return bitset;
+		if (s == "octree") return octree;
+		return -1;
+	}
+
+	/* bits are stored from the least significant one, into zeroed bytes */
+	struct BitWriter
+	{
+		unsigned char * const buf;
+		const int limit;
+		int pos;
+
+		BitWriter(unsigned char * const buf, const int maxbytes): buf(buf), limit(8 * maxbytes), pos(0) { }
+
+		inline void put(const unsigned int bit)
+		{
+			if (pos < limit)
+				buf[pos >> 3] |= bit << (pos & 7);
+
+			++pos;
+		}
+
+		// back to a previous position: the bits written since then are cleared
+		inline void rewind(const int mark)
+		{
+			for(int p = mark; p < pos && p < limit; ++p)
+				buf[p >> 3] &= ~(1u << (p & 7));
+
+			pos = mark;
+		}
+
+		bool overflow() const { return pos > limit; }
+	};
+
+	struct BitReader
+	{
+		const unsigned char * const buf;
+		int pos;
+		unsigned long long subbands;	// see decode
+
+		BitReader(const unsigned char * const buf): buf(buf), pos(0), subbands(0) { }
+
+		inline unsigned int get()
+		{
+			const unsigned int bit = buf[pos >> 3] >> (pos & 7) & 1;
+			++pos;
+			return bit;
+		}
+	};
+
+	/* bit of the subband code (1 to 7) of side bsh in the subbands of decode */
+	inline int subband(const int bsh, const int code)
+	{
+		int level = 0;
+		while (1 << level < bsh) ++level;
+
+		return 8 * level + code;
+	}
+
+	/* octant of side S at (x0, y0, z0) of a REFBS^3 mask (bit i: x + REFBS * (y + REFBS * z)).
+	   known: the octant is significant and its bit is not stored */
+	template<int REFBS, int S>
+	struct Octant
+	{
+		static bool encode(const unsigned char * const mask, BitWriter& w, const int x0, const int y0, const int z0, const bool known)
+		{
+			if (S == 4 && x0 == 0 && y0 == 0 && z0 == 0) return true;	// scaling coefficients
+
+			const int mark = w.pos;
+
+			// the bit of an octant not known to be significant is written as 1 and taken back if it is empty
+			if (!known) w.put(1);
+
+			bool any = false;
+
+			for(int c = 0; c < 8; ++c)
+			{
+				const bool origin = x0 == 0 && y0 == 0 && z0 == 0 && c == 0;
+				const bool last = known && c == 7 && !any;
+
+				any |= Octant<REFBS, S / 2>::encode(mask, w, x0 + S / 2 * (c & 1), y0 + S / 2 * (c >> 1 & 1), z0 + S / 2 * (c >> 2), origin || last);
+			}
+
+			if (!any)
+			{
+				w.rewind(mark);
+				w.put(0);
+			}
+
+			return any;
+		}
+
+		static void decode(BitReader& r, unsigned char * const mask, const int x0, const int y0, const int z0, const bool known)
+		{
+			if (S == 4 && x0 == 0 && y0 == 0 && z0 == 0)
+			{
+				for(int z = 0; z < 4; ++z)
+					for(int y = 0; y < 4; ++y)
+						mask[REFBS * (y + REFBS * z) / 8] |= 0xf;
+
+				return;
+			}
+
+			if (!known && !r.get()) return;
+
+			// no octant before the last one is significant: the last one is known, like in encode
+			bool any = false;
+
+			for(int c = 0; c < 8; ++c)
+			{
+				const bool origin = x0 == 0 && y0 == 0 && z0 == 0 && c == 0;
+				const bool last = known && c == 7 && !any;
+				const int mark = r.pos;
+
+				Octant<REFBS, S / 2>::decode(r, mask, x0 + S / 2 * (c & 1), y0 + S / 2 * (c >> 1 & 1), z0 + S / 2 * (c >> 2), origin || last);
+
+				const bool significant = origin || last || r.buf[mark >> 3] >> (mark & 7) & 1;
+				any |= significant;
+
+				// the octants of the corner are the subbands
+				if (x0 == 0 && y0 == 0 && z0 == 0 && significant)
+					r.subbands |= 1ull << subband(S / 2, c);
+			}
+		}
+	};
+
+	/* 2^3 leaves: the 8 bits in (z, y, x) order, the 8th one implied if the others are 0 */
+	template<int REFBS>
+	struct Octant<REFBS, 2>
+	{
+		static inline unsigned int _bits(const unsigned char * const mask, const int x0, const int y0, const int z0)
+		{
+			unsigned int b = 0;
+
+			for(int dz = 0; dz < 2; ++dz)
+				for(int dy = 0; dy < 2; ++dy)
+				{
+					const int i = x0 + REFBS * (y0 + dy + REFBS * (z0 + dz));
+
+					b |= (mask[i >> 3] >> (i & 7) & 3) << (2 * (dy + 2 * dz));
+				}
+
+			return b;
+		}
+
+		static bool encode(const unsigned char * const mask, BitWriter& w, const int x0, const int y0, const int z0, const bool known)
+		{
+			const unsigned int b = _bits(mask, x0, y0, z0);
+
+			if (!known) w.put(b != 0);
+			if (!b) return false;
+
+			for(int l = 0; l < 7; ++l)
+				w.put(b >> l & 1);
+
+			if (b & 0x7f) w.put(b >> 7);
+
+			return true;
+		}
+
+		static void decode(BitReader& r, unsigned char * const mask, const int x0, const int y0, const int z0, const bool known)
+		{
+			if (!known && !r.get()) return;
+
+			unsigned int b = 0;
+
+			for(int l = 0; l < 7; ++l)
+				b |= r.get() << l;
+
+			b |= ((b & 0x7f) ? r.get() : 1) << 7;
+
+			for(int dz = 0; dz < 2; ++dz)
+				for(int dy = 0; dy < 2; ++dy)
+				{
+					const int i = x0 + REFBS * (y0 + dy + REFBS * (z0 + dz));
+
+					mask[i >> 3] |= (b >> (2 * (dy + 2 * dz)) & 3) << (i & 7);
+				}
+		}
+	};
+
+	/* the octree of the BS^3 mask into at most maxbytes bytes of out.
+	   returns the number of bytes, or -1 if they are more than maxbytes */
+	template<int BS>
+	int encode(const unsigned char * const mask, unsigned char * const out, const int maxbytes)
+	{
+		memset(out, 0, maxbytes);
+
+		BitWriter w(out, maxbytes);
+
+		Octant<BS, BS>::encode(mask, w, 0, 0, 0, true);
+
+		return w.overflow() ? -1 : (w.pos + 7) / 8;
+	}
+
+	/* the mask bytes ((BS^3 + 7) / 8) back from the octree. returns the bytes read.
+	   subbands: the bit subband(bsh, code) is set if the subband has survivors */
+	template<int BS>
+	int decode(const unsigned char * const in, unsigned char * const mask, unsigned long long * const subbands = NULL)
+	{
+		memset(mask, 0, (BS * BS * BS + 7) / 8);
+
+		BitReader r(in);
+
+		Octant<BS, BS>::decode(r, mask, 0, 0, 0, true);
+
+		if (subbands != NULL)
+			*subbands = r.subbands;
+
+		return (r.pos + 7) / 8;
+	}
+}
+
+#endif
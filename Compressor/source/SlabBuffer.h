@@ -0,0 +1,171 @@
+/*
+ * SlabBuffer.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _SLABBUFFER_H_
+#define _SLABBUFFER_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* the compressed data of a rank: a range of bytes stored in slabs of SLABBYTES that are
+   allocated at their first write and never move. the threads write their chunks at the
+   offsets they reserved, concurrently and without locks. the bytes written to each slab
+   are counted, to tell which slabs are complete. a slab released once written to the file
+   becomes a spare, taken by the next slab to allocate. rewind keeps the slabs and the spares
+   of the last dump for the next one and frees those it did not touch. override the
+   size of the slabs with -D_SLAB_BYTES_= */
+#ifndef _SLAB_BYTES_
+#define _SLAB_BYTES_ (16 << 20)
+#endif
+
+class SlabBuffer
+{
+public:
+
+	enum
+	{
+		SLABBYTES = _SLAB_BYTES_,
+		MAXSLABS = 1 << 14	// 256 GB with the default
+	};
+
+private:
+
+	std::vector<unsigned char *> slabs;
+	std::vector<size_t> filled;	// bytes written to each slab
+	std::vector<unsigned char *> spares;	// released slabs, not freed
+	size_t idle;	// spares not taken since rewind
+
+	SlabBuffer(const SlabBuffer&);
+	SlabBuffer& operator=(const SlabBuffer&);
+
+	unsigned char * _slab(const size_t k)
+	{
+		if (k >= MAXSLABS)
+		{
+			printf("SlabBuffer: more than %d slabs of %d bytes!!\n", (int)MAXSLABS, (int)SLABBYTES);
+			abort();
+		}
+
+		unsigned char * s = __atomic_load_n(&slabs[k], __ATOMIC_ACQUIRE);
+
+		if (s == NULL)
+		{
+			unsigned char * mine = NULL;
+
+#pragma omp critical (slabspares)
+			if (!spares.empty())
+			{
+				mine = spares.back();
+				spares.pop_back();
+				idle = std::min(idle, spares.size());
+			}
+
+			if (mine == NULL)
+				mine = (unsigned char *)malloc(SLABBYTES);
+
+			if (mine == NULL)
+			{
+				printf("SlabBuffer: out of memory for slab %d of %d bytes!!\n", (int)k, (int)SLABBYTES);
+				abort();
+			}
+
+			// another thread may have been faster
+			if (__atomic_compare_exchange_n(&slabs[k], &s, mine, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				s = mine;
+			else
+			{
+#pragma omp critical (slabspares)
+				spares.push_back(mine);
+			}
+		}
+
+		return s;
+	}
+
+public:
+
+	SlabBuffer(): slabs(MAXSLABS, (unsigned char *)NULL), filled(MAXSLABS, 0), idle(0) { }
+
+	~SlabBuffer()
+	{
+		for(size_t k = 0; k < slabs.size(); ++k)
+			free(slabs[k]);
+
+		for(size_t i = 0; i < spares.size(); ++i)
+			free(spares[i]);
+	}
+
+	/* bytes [offset, offset + nbytes) from src, they may span several slabs */
+	void write(const size_t offset, const void * const src, const size_t nbytes)
+	{
+		const unsigned char * ptr = (const unsigned char *)src;
+
+		for(size_t start = offset, end = offset + nbytes; start < end; )
+		{
+			const size_t k = start / SLABBYTES, s0 = start % SLABBYTES;
+			const size_t n = std::min(end - start, (size_t)SLABBYTES - s0);
+
+			memcpy(_slab(k) + s0, ptr, n);
+			__atomic_add_fetch(&filled[k], n, __ATOMIC_RELEASE);
+
+			ptr += n;
+			start += n;
+		}
+	}
+
+	/* all the bytes of slab k were written */
+	bool full(const int k) const { return __atomic_load_n(&filled[k], __ATOMIC_ACQUIRE) == SLABBYTES; }
+
+	/* slab k is not needed anymore, it becomes a spare */
+	void release(const int k)
+	{
+		if (slabs[k] == NULL)
+			return;
+
+#pragma omp critical (slabspares)
+		spares.push_back(slabs[k]);
+
+		slabs[k] = NULL;
+	}
+
+	/* a new range of bytes, from offset 0 */
+	void rewind()
+	{
+		for(size_t k = 0; k < slabs.size(); ++k)
+			if (filled[k] == 0 && slabs[k] != NULL)
+			{
+				free(slabs[k]);
+				slabs[k] = NULL;
+			}
+
+		for(size_t i = 0; i < idle; ++i)
+			free(spares[i]);
+
+		spares.erase(spares.begin(), spares.begin() + idle);
+		idle = spares.size();
+
+		std::fill(filled.begin(), filled.end(), (size_t)0);
+	}
+
+	/* the slabs that hold the first nbytes */
+	int count(const size_t nbytes) const { return (nbytes + SLABBYTES - 1) / SLABBYTES; }
+
+	unsigned char * slab(const int k) const { return slabs[k]; }
+
+	/* bytes of slab k among the first nbytes */
+	int bytes(const int k, const size_t nbytes) const { return std::min(nbytes - (size_t)k * SLABBYTES, (size_t)SLABBYTES); }
+};
+
+#endif
@@ -15,7 +15,6 @@ typedef double Real;
 #endif
 
 #include <cstdio>
-#include <bitset>
 #include <cassert>
 
 using namespace std;
@@ -30,181 +29,173 @@ void swapbytes(unsigned char *mem, int nbytes)
 }
 
 
-#if defined(_USE_ZEROBITS_)
-void float_zero_bits3(unsigned int *ul, int n)
+// number of bits set in the mask bytes, i.e. the number of survivors
+static int popcount_mask(const unsigned char * const buf, const int nbytes)
 {
-        unsigned int _ul = *ul;
-        unsigned long mask = ~((1 << n) - 1);
-        _ul = _ul & mask;
+	int sum = 0;
+	int B = 0;
 
-        *ul = _ul;
+	for(; B + 8 <= nbytes; B += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, buf + B, sizeof(word));
 
+		sum += __builtin_popcountll(word);
+	}
 
-}
+	for(; B < nbytes; ++B)
+		sum += __builtin_popcount(buf[B]);
 
-float float_zero_bits3b(float x, int bits)
-{
-        union { int ix; float fx; } v;
-        v.fx = x;
-        v.ix &= ~((1 << bits) - 1);
+	return sum;
+}
 
-        return v.fx;
+template<int DATASIZE1D, typename DataType>
+size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float threshold, const int halffloat, int wtype)
+{				
+	full.fwt(wtype);
+	
+	return compress_coefficients(threshold, halffloat);
 }
-#endif
 
-#if defined(_USE_SHUFFLE3_)
-static void shuffle3(char *in, int n, int s)
-{
-	int i, j, b;
-	char *tmp = (char *)malloc(n);
+template<int DATASIZE1D, typename DataType>
+size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress_coefficients(const float threshold, const int halffloat)
+{				
+	assert(BITSETSIZE % sizeof(DataType) == 0);
+	
+	// the mask bytes are produced directly by the thresholding
+	memset(bufcompression, 0, BITSETSIZE);
+
+	const int survivors = full.template threshold<DataType, DATASIZE1D>(threshold, bufcompression, (DataType *)(bufcompression + BITSETSIZE));
+
+	// set some bits to zero
+	ZeroBits::apply(zerobits, (DataType *)(bufcompression + BITSETSIZE), survivors);
 
-	j = 0;
-	for (b = 0; b < s; b++)
+	if (quantizer == BitPlane::bitplane)
 	{
-		for (i = b; i < n; i+= s)
-		{
-			tmp[j] = in[i];
-			j++;
-		}
+		bufquant.resize(BS3);
+
+		const int nbytes = BitPlane::encode((DataType *)(bufcompression + BITSETSIZE), survivors, threshold, &bufquant[0], bufcompression + BITSETSIZE);
+
+		return encode_sigmap(nbytes) + nbytes;
 	}
 
-	memcpy(in, tmp, n);
-	free(tmp);
-}
+	// reduced precision survivors, if any. those of a block out of its range keep their width
+	const int format = HalfFloat::fits((DataType *)(bufcompression + BITSETSIZE), survivors, halffloat) ? halffloat : HalfFloat::none;
 
-void reshuffle3(char *in, int n, int s)
-{
-	int i, j, b;
-	char *tmp = (char *)malloc(n);
+	HalfFloat::narrow((DataType *)(bufcompression + BITSETSIZE), survivors, format);
 
-	int c = n/s;
+	const int esize = HalfFloat::size(format, sizeof(DataType));
 
-	j = 0;
-	for (i = 0; i < n/s; i++)
-	{
-		for (b = 0; b < s; b++)
-		{
-			tmp[j] = in[i + b*c]; j++;
-		}
-	}
+	const size_t offset = encode_sigmap(esize * survivors);
 
-	memcpy(in, tmp, n);
-	free(tmp);
+	Shuffle::encode(shuffle, bufcompression + offset, survivors*esize, esize);
+
+	return offset + esize * survivors;
 }
-#endif
 
-template<int N>
-void serialize_bitset(bitset<N> mybits, unsigned char * const buf, const int nbytes)
+/* octree: [1][octree bytes][padding to MAPALIGN][survivors], or [0][padding][mask][survivors]
+   if the octree is not smaller than the mask. returns where the survivors start */
+template<int DATASIZE1D, typename DataType>
+size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::encode_sigmap(const size_t survivorbytes)
 {
-	assert(nbytes == (N + 7) / 8);
-	
-	const int nicebits = 8 * (N / 8);
-	
-	for(int i = 0, B = 0; i < nicebits; i += 8, ++B)
-	{
-		unsigned char c = 0;
-		
-		for(int b = 0; b < 8; ++b)
-			c |= mybits[i + b] << b;
-		
-		buf[B] = c;
-	}
-	
-	if (nicebits < N)
+	if (sigmap == SignificanceMap::bitset)
+		return BITSETSIZE;
+
+	const int mapbytes = SignificanceMap::encode<DATASIZE1D>(bufcompression, bufmask, BITSETSIZE - MAPALIGN);
+
+	if (mapbytes < 0)
 	{
-		unsigned char c = 0;
-		
-		for(int b = nicebits; b < N; ++b)
-			c |= mybits[b] << (b - nicebits);
-		
-		buf[nbytes - 1] = c;
+		memmove(bufcompression + MAPALIGN, bufcompression, BITSETSIZE + survivorbytes);
+		memset(bufcompression, 0, MAPALIGN);
+
+		return MAPALIGN + BITSETSIZE;
 	}
+
+	const size_t offset = (1 + mapbytes + MAPALIGN - 1) / MAPALIGN * MAPALIGN;
+
+	memmove(bufcompression + offset, bufcompression + BITSETSIZE, survivorbytes);
+
+	memset(bufcompression, 0, offset);
+	bufcompression[0] = 1;
+	memcpy(bufcompression + 1, bufmask, mapbytes);
+
+	return offset;
 }
 
-template<int N>
-int deserialize_bitset(bitset<N>& mybits, const unsigned char * const buf, const int nbytes)
+/* the mask of the stream in bufcompression, and in offset where the survivors start.
+   subbands: those with survivors (see SignificanceMap::decode), all of them without octree */
+template<int DATASIZE1D, typename DataType>
+const unsigned char * WaveletCompressorGeneric<DATASIZE1D, DataType>::decode_sigmap(int& offset, unsigned long long& subbands)
 {
-	assert(nbytes == (N + 7) / 8);
-	
-	int sum = 0;
-	
-	const int nicebits = 8 * (N / 8);
-	
-	for(int i = 0, B = 0; i < nicebits; i += 8, ++B)
+	subbands = ~0ull;
+
+	if (sigmap == SignificanceMap::bitset)
 	{
-		const unsigned char c = buf[B];
-		
-		for(int b = 0; b < 8; ++b)
-			sum += (mybits[i + b] = (c >> b) & 1);		
+		offset = BITSETSIZE;
+		return bufcompression;
 	}
-	
-	if (nicebits < N)
+
+	if (bufcompression[0] == 0)
 	{
-		const unsigned char c = buf[nbytes - 1];
-		
-		for(int b = nicebits; b < N; ++b)
-			sum += (mybits[b] = (c >> (b - nicebits)) & 1);
+		offset = MAPALIGN + BITSETSIZE;
+		return bufcompression + MAPALIGN;
 	}
-	
-	return sum;
+
+	const int mapbytes = SignificanceMap::decode<DATASIZE1D>(bufcompression + 1, bufmask, &subbands);
+
+	offset = (1 + mapbytes + MAPALIGN - 1) / MAPALIGN * MAPALIGN;
+	return bufmask;
 }
 
 template<int DATASIZE1D, typename DataType>
-size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float threshold, const bool float16, int wtype)
-{				
-	full.fwt(wtype);
-	
-	assert(BITSETSIZE % sizeof(DataType) == 0);
-	
-	bitset<BS3> mask;
-	const int survivors = full.template threshold<DataType, DATASIZE1D>(threshold, mask, (DataType *)(bufcompression + BITSETSIZE));
+int WaveletCompressorGeneric<DATASIZE1D, DataType>::survivors_offset(const unsigned char * const stream, const int sigmap)
+{
+	if (sigmap == SignificanceMap::bitset)
+		return BITSETSIZE;
 
-	serialize_bitset<BS3>(mask, bufcompression, BITSETSIZE);
+	if (stream[0] == 0)
+		return MAPALIGN + BITSETSIZE;
 
-#if defined(_USE_SHUFFLE3_)||defined(_USE_ZEROBITS_)
+	unsigned char mask[BITSETSIZE];
+	const int mapbytes = SignificanceMap::decode<DATASIZE1D>(stream + 1, mask);
 
-  #if defined(_USE_ZEROBITS_)
-	// set some bits to zero
-	for(int i = 0; i < survivors; ++i) 
+	return (1 + mapbytes + MAPALIGN - 1) / MAPALIGN * MAPALIGN;
+}
+
+template<int DATASIZE1D, typename DataType>
+int WaveletCompressorGeneric<DATASIZE1D, DataType>::survivors_esize(const unsigned char * const stream, const int nbytes, const int sigmap, const int halffloat)
+{
+	unsigned char octree[BITSETSIZE];
+	const unsigned char * mask = stream + (sigmap == SignificanceMap::bitset ? 0 : MAPALIGN);
+
+	if (sigmap != SignificanceMap::bitset && stream[0] != 0)
 	{
-		DataType *ps = (i + (DataType *)(bufcompression + BITSETSIZE));
-		float_zero_bits3((unsigned int *)ps, _ZEROBITS_);	// xxx: extend it for doubles
+		SignificanceMap::decode<DATASIZE1D>(stream + 1, octree);
+		mask = octree;
 	}
-  #endif
 
-  #if defined(_USE_SHUFFLE3_)
-	shuffle3((char *)(bufcompression + BITSETSIZE), survivors*sizeof(DataType), sizeof(DataType));
-  #endif
+	const int offset = survivors_offset(stream, sigmap);
 
-#endif
-
-	return BITSETSIZE + sizeof(DataType) * survivors;
+	return HalfFloat::size(survivors_format(halffloat, nbytes - offset, popcount_mask(mask, BITSETSIZE)), sizeof(DataType));
 }
 
 
+// the survivors of the swapped stream are written full width, whatever the halffloat format
 template<int DATASIZE1D, typename DataType>
-size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float threshold, const bool float16, bool swap, int wtype)
+size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float threshold, const int, bool swap, int wtype)
 {				
 	full.fwt(wtype);
 	
 	exit(1);
 	assert(BITSETSIZE % sizeof(DataType) == 0);
 	
-	bitset<BS3> mask;
-	const int survivors = full.template threshold<DataType, DATASIZE1D>(threshold, mask, (DataType *)(bufcompression + BITSETSIZE));
+	// the mask bytes are produced directly by the thresholding
+	memset(bufcompression, 0, BITSETSIZE);
 
-	serialize_bitset<BS3>(mask, bufcompression, BITSETSIZE);
+	const int survivors = full.template threshold<DataType, DATASIZE1D>(threshold, bufcompression, (DataType *)(bufcompression + BITSETSIZE));
 
-#if defined(_USE_SHUFFLE3_)||defined(_USE_ZEROBITS_)
-
-  #if defined(_USE_ZEROBITS_)
 	// set some bits to zero
-	for(int i = 0; i < survivors; ++i) 
-	{
-		DataType *ps = (i + (DataType *)(bufcompression + BITSETSIZE));
-		float_zero_bits3((unsigned int *)ps, _ZEROBITS_);	// xxx: extend it for doubles
-	}
-  #endif
+	ZeroBits::apply(zerobits, (DataType *)(bufcompression + BITSETSIZE), survivors);
 
 	// peh: need to verify if this is the correct place for byte swapping. However, swapping is in general useless for the compression tool.
 	if (swap)
@@ -216,12 +207,7 @@ size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float thre
 		}
 	}
 
-
-  #if defined(_USE_SHUFFLE3_)
-	shuffle3((char *)(bufcompression + BITSETSIZE), survivors*sizeof(DataType), sizeof(DataType));
-  #endif
-
-#endif
+	Shuffle::encode(shuffle, bufcompression + BITSETSIZE, survivors*sizeof(DataType), sizeof(DataType));
 
 	return BITSETSIZE + sizeof(DataType) * survivors;
 	
@@ -229,33 +215,56 @@ size_t WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(const float thre
 
 
 template<int DATASIZE1D, typename DataType>
-void WaveletCompressorGeneric<DATASIZE1D, DataType>::decompress(const bool float16, size_t bytes, int wtype)
+void WaveletCompressorGeneric<DATASIZE1D, DataType>::decompress(const int halffloat, size_t bytes, int wtype)
 {
-	bitset<BS3> mask;
-	const int expected = deserialize_bitset<BS3>(mask, bufcompression, BITSETSIZE);
+	load_coefficients(halffloat, bytes);
+	
+	full.iwt(wtype);
+}
 
-#if defined(_USE_SHUFFLE3_)
-	reshuffle3((char *)(bufcompression + BITSETSIZE), bytes - BITSETSIZE, sizeof(DataType));
-#endif
+template<int DATASIZE1D, typename DataType>
+void WaveletCompressorGeneric<DATASIZE1D, DataType>::load_coefficients(const int halffloat, size_t bytes, const int lod)
+{
+	int offset;
+	unsigned long long subbands;
+	const unsigned char * const mask = decode_sigmap(offset, subbands);
+	const int expected = popcount_mask(mask, BITSETSIZE);
 
-	assert((bytes - sizeof(bitset<BS3>)) % sizeof(DataType) == 0 || float16);
-	assert((bytes - sizeof(bitset<BS3>)) % sizeof(unsigned short) == 0);
-	
-	size_t bytes_read = BITSETSIZE;
-	
-	//const
-	int nelements = (bytes - bytes_read) / (float16 ? sizeof(unsigned short) : sizeof(DataType));
-	if (nelements - expected == 1) {
-		nelements--;
+	// the stream must hold the survivors of the mask, corrupt or truncated ones are not scattered
+	bool complete = offset <= (int)bytes;
+
+	if (complete && quantizer == BitPlane::bitplane)
+	{
+		bufquant.resize(BS3);
+
+		complete = BitPlane::decode(bufcompression + offset, bytes - offset, expected, &bufquant[0], (DataType *)(bufcompression + offset), maxplanes);
 	}
-	assert(expected == nelements);
-	
-	vector<DataType> datastream(nelements);
-	
-	memcpy((void *)&datastream.front(), bufcompression + bytes_read, sizeof(DataType) * nelements);	
-	
-	full.load(datastream, mask);
-	full.iwt(wtype);
+	else if (complete)
+	{
+		const int format = survivors_format(halffloat, bytes - offset, expected);
+		const int esize = HalfFloat::size(format, sizeof(DataType));
+		const int nelements = (bytes - offset) / esize;
+
+		// older files may have one more
+		complete = (bytes - offset) % esize == 0 && (nelements == expected || nelements == expected + 1);
+
+		if (complete)
+		{
+			Shuffle::decode(shuffle, bufcompression + offset, bytes - offset, esize);
+
+			// back to DataType, in place (the buffer holds BS3 of them)
+			HalfFloat::widen((DataType *)(bufcompression + offset), expected, format);
+		}
+	}
+
+	if (!complete)
+	{
+		printf("WAVELET DECOMPRESSION FAILURE!! (%d survivors in the mask, not in the %d bytes of the stream)\n", expected, (int)bytes);
+		abort();
+	}
+
+	// the survivors are scattered straight from the compression buffer
+	full.load((const DataType *)(bufcompression + offset), mask, lod, subbands);
 }
 
 #ifdef _BLOCKSIZE_
@@ -15,10 +15,17 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <vector>
 
 #include "FullWaveletTransform.h"
+#include "HalfFloat.h"
+#include "SignificanceMap.h"
+#include "BitPlane.h"
+#include "Shuffle.h"
+#include "ZeroBits.h"
 
 #include <zlib.h>	// always needed
+#include "ZStreams.h"
 
 #if defined(_USE_LZ4_)
 #include <lz4.h>
@@ -30,8 +37,6 @@ typedef float Real;
 typedef double Real;
 #endif
 
-static const bool lifting_scheme = false; // peh: disabled: xxx: check this again
-
 template<int DATASIZE1D, typename DataType>
 class WaveletCompressorGeneric
 {
@@ -41,7 +46,8 @@ protected:
 	{
 		BS3 = DATASIZE1D * DATASIZE1D * DATASIZE1D,
 		BITSETSIZE = (BS3 + 7) / 8,
-		BUFMAXSIZE = BITSETSIZE + sizeof(DataType) * BS3
+		MAPALIGN = 8,	// the survivors that follow a coded significance map start at a multiple of it
+		BUFMAXSIZE = MAPALIGN + BITSETSIZE + BitPlane::HEADER + sizeof(DataType) * BS3
 	};
 
 	WaveletsOnInterval::FullTransform<DATASIZE1D> full;
@@ -49,23 +55,83 @@ protected:
 private:
 
 	unsigned char bufcompression[BUFMAXSIZE];
+	unsigned char bufmask[BITSETSIZE];	// the mask behind a coded significance map
+	std::vector<unsigned int> bufquant;	// quantized survivors, allocated on first use
+
+	ZeroBits::Settings zerobits;	// of the survivors
 
-	size_t bufsize;
+	int sigmap;	// SignificanceMap::Format of the stream
+	int quantizer;	// BitPlane::Format of the survivors
+	int maxplanes;	// bit planes decoded at most
+	int shuffle;	// Shuffle::Format of the survivors
+
+	size_t encode_sigmap(const size_t survivorbytes);
+	const unsigned char * decode_sigmap(int& offset, unsigned long long& subbands);
 
 public:
 
+	WaveletCompressorGeneric(): sigmap(SignificanceMap::bitset), quantizer(BitPlane::none), maxplanes(BitPlane::MAXPLANES), shuffle(Shuffle::DEFAULT) { }
+
+	virtual ~WaveletCompressorGeneric() { }
+
+	void set_sigmap(const int format) { sigmap = format; }
+
+	void set_shuffle(const int format) { shuffle = format; }
+
+	void set_zerobits(const ZeroBits::Settings& settings) { zerobits = settings; }
+
+	// with BitPlane::bitplane the survivors are quantized and halffloat is not used
+	void set_quantizer(const int format, const int maxplanes = BitPlane::MAXPLANES)
+	{
+		quantizer = format;
+		this->maxplanes = maxplanes;
+	}
+
 	WaveletsOnInterval::FwtAp (& uncompressed_data()) [DATASIZE1D][DATASIZE1D][DATASIZE1D] { return full.data; }
 
 	virtual void * compressed_data() { return bufcompression; }
 
-	virtual	size_t compress(const float threshold, const bool float16, int wtype);
-	virtual	size_t compress(const float threshold, const bool float16, bool swap, int wtype);
+	virtual	size_t compress(const float threshold, const int halffloat, int wtype);
+	virtual	size_t compress(const float threshold, const int halffloat, bool swap, int wtype);
+
+	virtual void decompress(const int halffloat, size_t bytes, int wtype);
+
+	// the two halves of compress/decompress, for blocks transformed elsewhere (FullTransformBatch)
+	size_t compress_coefficients(const float threshold, const int halffloat);
+	void load_coefficients(const int halffloat, size_t bytes, const int lod = 0);
+
+	// where the survivors of a stream with the significance map format sigmap start
+	static int survivors_offset(const unsigned char * const stream, const int sigmap);
 
-	virtual void decompress(const bool float16, size_t bytes, int wtype);
+	// the HalfFloat::Format of the survivors of a stream: halffloat, unless they take their full width
+	static int survivors_format(const int halffloat, const size_t survivorbytes, const int survivors)
+	{
+		const bool narrow = HalfFloat::size(halffloat, sizeof(DataType)) < (int)sizeof(DataType);
+
+		return narrow && survivorbytes == survivors * sizeof(DataType) ? (int)HalfFloat::none : halffloat;
+	}
+
+	// bytes per survivor of a stream of nbytes
+	static int survivors_esize(const unsigned char * const stream, const int nbytes, const int sigmap, const int halffloat);
+
+	enum { MAXLOD = WaveletsOnInterval::FullTransform<DATASIZE1D>::MAXLOD };
+
+	// the largest stream of a block
+	enum { MAXSTREAMBYTES = BUFMAXSIZE };
+
+	/* level of detail: the lod finest levels are neither decoded nor inverted and data
+	   gets the (DATASIZE1D >> lod)^3 scaling coefficients of the block, x fastest */
+	void decompress_lod(const int halffloat, size_t bytes, int wtype, const int lod, DataType * const data)
+	{
+		load_coefficients(halffloat, bytes, lod);
+
+		full.iwt(wtype, lod);
+		full.copy_lod(lod, data);
+	}
 
-	virtual void decompress(const bool float16, size_t ninputbytes, int wtype, DataType data[DATASIZE1D][DATASIZE1D][DATASIZE1D])
+	virtual void decompress(const int halffloat, size_t ninputbytes, int wtype, DataType data[DATASIZE1D][DATASIZE1D][DATASIZE1D])
 	{
-		decompress(float16, ninputbytes, wtype);
+		decompress(halffloat, ninputbytes, wtype);
 
 		this->copy_to(data);
 	}
@@ -102,30 +168,27 @@ public:
 
 	void * compressed_data() { return bufzlib; }
 
-	size_t compress(const float threshold, const bool float16, int wtype)
+	size_t compress(const float threshold, const int halffloat, int wtype)
 	{
 		int compressedbytes = 0;
 
 #if defined(_USE_ZLIB_)
-		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, float16, wtype);
-		z_stream datastream = { 0 };
-		datastream.total_in = datastream.total_out = 0;
+		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, halffloat, wtype);
+		z_stream& datastream = *ZStreams::deflate_stream();
 		datastream.avail_in = ninputbytes;
 		datastream.avail_out = WaveletCompressorGeneric<DATASIZE1D, DataType>::BUFMAXSIZE;
 		datastream.next_in = (unsigned char*) WaveletCompressorGeneric<DATASIZE1D, DataType>::compressed_data();
 		datastream.next_out = bufzlib;
 
-		if (Z_OK == deflateInit(&datastream, Z_DEFAULT_COMPRESSION) && Z_STREAM_END == deflate(&datastream, Z_FINISH))
+		if (Z_STREAM_END == deflate(&datastream, Z_FINISH))
 			compressedbytes = datastream.total_out;
 		else
 		{
 			printf("ZLIB COMPRESSION FAILURE!!\n");
 			abort();
 		}
-
-		deflateEnd( &datastream );
 #elif defined(_USE_LZ4)
-		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, float16, wtype);
+		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, halffloat, wtype);
 		compressedbytes = LZ4_compress((char*) WaveletCompressorGeneric<DATASIZE1D, DataType>::compressed_data(), (char *)bufzlib, ninputbytes);
 		if (compressedbytes < 0)
 		{
@@ -137,30 +200,27 @@ public:
 		return compressedbytes;
 	}
 
-	size_t compress(const float threshold, const bool float16, bool swap, int wtype)
+	size_t compress(const float threshold, const int halffloat, bool swap, int wtype)
 	{
 		int compressedbytes = 0;
 
 #if defined(_USE_ZLIB_)
-		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, float16, swap, wtype);
-		z_stream datastream = { 0 };
-		datastream.total_in = datastream.total_out = 0;
+		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, halffloat, swap, wtype);
+		z_stream& datastream = *ZStreams::deflate_stream();
 		datastream.avail_in = ninputbytes;
 		datastream.avail_out = WaveletCompressorGeneric<DATASIZE1D, DataType>::BUFMAXSIZE;
 		datastream.next_in = (unsigned char*) WaveletCompressorGeneric<DATASIZE1D, DataType>::compressed_data();
 		datastream.next_out = bufzlib;
 
-		if (Z_OK == deflateInit(&datastream, Z_DEFAULT_COMPRESSION) && Z_STREAM_END == deflate(&datastream, Z_FINISH))
+		if (Z_STREAM_END == deflate(&datastream, Z_FINISH))
 			compressedbytes = datastream.total_out;
 		else
 		{
 			printf("ZLIB COMPRESSION FAILURE!!\n");
 			abort();
 		}
-
-		deflateEnd( &datastream );
 #elif defined(_USE_LZ4)
-		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, float16, swap, wtype);
+		const size_t ninputbytes = WaveletCompressorGeneric<DATASIZE1D, DataType>::compress(threshold, halffloat, swap, wtype);
 		compressedbytes = LZ4_compress((char*) WaveletCompressorGeneric<DATASIZE1D, DataType>::compressed_data(), (char *)bufzlib, ninputbytes);
 		if (compressedbytes < 0)
 		{
@@ -172,21 +232,18 @@ public:
 		return compressedbytes;
 	}
 
-	void decompress(const bool float16, size_t ninputbytes, int wtype)
+	void decompress(const int halffloat, size_t ninputbytes, int wtype)
 	{
 #if defined(_USE_ZLIB_)
 		int decompressedbytes = 0;
 
-		z_stream datastream = { 0 };
-		datastream.total_in = datastream.total_out = 0;
+		z_stream& datastream = *ZStreams::inflate_stream();
 		datastream.avail_in = ninputbytes;
 		datastream.avail_out = WaveletCompressorGeneric<DATASIZE1D, DataType>::BUFMAXSIZE;
 		datastream.next_in = bufzlib;
 		datastream.next_out = (unsigned char*) WaveletCompressorGeneric<DATASIZE1D, DataType>::compressed_data();
 
-		const int retval = inflateInit(&datastream);
-
-		if (retval == Z_OK && inflate(&datastream, Z_FINISH))
+		if (inflate(&datastream, Z_FINISH))
 			decompressedbytes = datastream.total_out;
                 else
                 {
@@ -194,9 +251,7 @@ public:
                         abort();
                 }
 
-		inflateEnd(&datastream);
-
-		WaveletCompressorGeneric<DATASIZE1D, DataType>::decompress(float16, decompressedbytes, wtype);
+		WaveletCompressorGeneric<DATASIZE1D, DataType>::decompress(halffloat, decompressedbytes, wtype);
 #elif defined(_USE_LZ4)
 		int decompressedbytes = 0;
 
@@ -15,6 +15,7 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 
 using namespace std;
 
@@ -26,79 +27,151 @@ namespace WaveletsOnInterval
 	typedef double FwtAp;
 #endif
 
+	/* width of the SIMD registers targeted by the multi-line kernels (see Makefile: simd=) */
+#if defined(__AVX512F__)
+	enum { FWT_SIMD_BYTES = 64 };
+#elif defined(__AVX__)
+	enum { FWT_SIMD_BYTES = 32 };
+#else
+	enum { FWT_SIMD_BYTES = 16 };
+#endif
+	enum { FWT_SIMD_WIDTH = FWT_SIMD_BYTES / sizeof(FwtAp) };
+
+	/* lines of a sweep that span more than the L1 cache are transformed through a tile,
+	   FWT_TILE_BYTES of each line at a time (see WaveletSweep::sweep_tiled) */
+	enum { FWT_TILE_SPAN = 32 * 1024, FWT_TILE_BYTES = 256 };
+
+	/* W adjacent lines packed in one register, one line per lane (M: matching shuffle mask) */
+	template<int W>
+	struct FwtLanes
+	{
+		typedef FwtAp V __attribute__ ((vector_size (W * sizeof(FwtAp))));
+#ifdef _FLOAT_PRECISION_
+		typedef int M __attribute__ ((vector_size (W * sizeof(FwtAp))));
+#else
+		typedef long long M __attribute__ ((vector_size (W * sizeof(FwtAp))));
+#endif
+	};
+
 	//template <bool lifting>
 	struct WI4
 	{
+		/* the filters are templated on the element type: FwtAp for a single line, FwtLanes<W>::V for W lines at once.
+		   the coefficients are FwtAp so that float builds do not promote to double */
+
 		/* wi4 */
-		static inline FwtAp interp_first(const FwtAp f0, const FwtAp f1, const FwtAp f2, const FwtAp f3) 
+		template<typename V>
+		static inline V interp_first(const V f0, const V f1, const V f2, const V f3) 
 		{
-			return 5./16 * f0 + 15./16 * f1 - 5./16 * f2 + 1./16 * f3;
+			const FwtAp c1 = 1./16, c5 = 5./16, c15 = 15./16;
+			return c5 * f0 + c15 * f1 - c5 * f2 + c1 * f3;
 		};
 		
-		static inline FwtAp interp_middle(const FwtAp f0, const FwtAp f1, const FwtAp f2, const FwtAp f3) 
+		template<typename V>
+		static inline V interp_middle(const V f0, const V f1, const V f2, const V f3) 
 		{
-			return -1./16 * f0 + 9./16 * f1 + 9./16 * f2 - 1./16 * f3;
+			const FwtAp c1 = 1./16, c9 = 9./16;
+			return c9 * (f1 + f2) - c1 * (f0 + f3);
 		};
 		
-		static inline FwtAp interp_onetolast(const FwtAp f0, const FwtAp f1, const FwtAp f2, const FwtAp f3) 
+		template<typename V>
+		static inline V interp_onetolast(const V f0, const V f1, const V f2, const V f3) 
 		{
-			return 1./16 * f0 - 5./16 * f1 + 15./16 * f2 + 5./16 * f3;
+			const FwtAp c1 = 1./16, c5 = 5./16, c15 = 15./16;
+			return c1 * f0 - c5 * f1 + c15 * f2 + c5 * f3;
 		};
 		
-		static inline FwtAp interp_last(const FwtAp f0, const FwtAp f1, const FwtAp f2, const FwtAp f3) 
+		template<typename V>
+		static inline V interp_last(const V f0, const V f1, const V f2, const V f3) 
 		{
-			return -5./16*f0 + 21./16*f1 -35./16*f2 + 35./16*f3;
+			const FwtAp c5 = 5./16, c21 = 21./16, c35 = 35./16;
+			return c21 * f1 - c5 * f0 + c35 * (f3 - f2);
 		};
 
 
 		/* aiw3 */
-		static inline FwtAp predict0_first(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		template<typename V>
+		static inline V predict0_first(const V A0, const V A1, const V A2)
+		{
+			const FwtAp c1 = 1./8, c4 = 1./2, c11 = 11./8;
+			return c11 * A0 - c4 * A1 + c1 * A2;
+		};
+
+		template<typename V>
+		static inline V predict1_first(const V A0, const V A1, const V A2)
+		{
+			const FwtAp c1 = 1./8, c4 = 1./2, c5 = 5./8;
+			return c5 * A0 + c4 * A1 - c1 * A2;
+		};
+
+		template<typename V>
+		static inline V predict0_middle(const V A0, const V A1, const V A2)
 		{
-			return 11./8 * A0 - 1./2 * A1 + 1./8 * A2;
+			const FwtAp c1 = 1./8;
+			return A1 + c1 * (A0 - A2);
 		};
 
-		static inline FwtAp predict1_first(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		template<typename V>
+		static inline V predict1_middle(const V A0, const V A1, const V A2)
 		{
-			return 5./8 * A0 + 1./2 * A1 - 1./8 * A2;
+			const FwtAp c1 = 1./8;
+			return A1 + c1 * (A2 - A0);
 		};
 
-		static inline FwtAp predict0_middle(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		template<typename V>
+		static inline V predict0_last(const V A0, const V A1, const V A2)
 		{
-			return 1./8 * A0 + A1 - 1./8 * A2;
+			const FwtAp c1 = 1./8, c4 = 1./2, c5 = 5./8;
+			return c4 * A1 - c1 * A0 + c5 * A2;
 		};
 
-		static inline FwtAp predict1_middle(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		template<typename V>
+		static inline V predict1_last(const V A0, const V A1, const V A2)
 		{
-			return -1./8 * A0 + A1 + 1./8 * A2;
+			const FwtAp c1 = 1./8, c4 = 1./2, c11 = 11./8;
+			return c1 * A0 - c4 * A1 + c11 * A2;
 		};
 
-		static inline FwtAp predict0_last(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		/* aiw3, lifting form: half of predict1 - predict0 */
+		template<typename V>
+		static inline V slope_first(const V A0, const V A1, const V A2)
 		{
-			return -1./8 * A0 + 1./2 * A1 + 5./8 * A2;
+			const FwtAp c1 = 1./8, c3 = 3./8, c4 = 1./2;
+			return c4 * A1 - c3 * A0 - c1 * A2;
 		};
 
-		static inline FwtAp predict1_last(const FwtAp A0, const FwtAp A1, const FwtAp A2)
+		template<typename V>
+		static inline V slope_middle(const V A0, const V, const V A2)
 		{
-			return 1./8 * A0 - 1./2 * A1 + 11./8 * A2;
+			const FwtAp c1 = 1./8;
+			return c1 * (A2 - A0);
 		};
 
-		template<const int N, bool forward>
-		static inline void transform(FwtAp data[N], int wtype)
+		template<typename V>
+		static inline V slope_last(const V A0, const V A1, const V A2)
+		{
+			const FwtAp c1 = 1./8, c3 = 3./8, c4 = 1./2;
+			return c1 * A0 - c4 * A1 + c3 * A2;
+		};
+
+		/* transforms one line (V = FwtAp) or as many lines as V has lanes.
+		   the wavelet type is a template parameter: every branch on it is resolved at compile time */
+		template<const int N, bool forward, int WTYPE, typename V>
+		static inline void transform(V data[N])
 		{			
 			assert(N >= 8);
 			assert(N%2==0);
 			
 			enum { Nhalf = N / 2 };
 
-			bool lifting = false;
-			if (wtype == 2) lifting = 1;
+			const bool lifting = (WTYPE == 2);
 
 			//printf("forward = %d, lifting = %d\n", forward, lifting);
-			if ((wtype == 1)|| (wtype == 2))
+			if ((WTYPE == 1)|| (WTYPE == 2))
 			{
 			if (forward)
 			{
-				FwtAp details[Nhalf];
+				V details[Nhalf];
 				
 				// compute first detail
 				details[0] = data[1] - interp_first(data[0], data[2], data[4], data[6]);
@@ -117,26 +190,26 @@ namespace WaveletsOnInterval
 				// compute last detail
 				details[Nhalf-1] = data[N-1] - interp_last(data[N-8], data[N-6], data[N-4], data[N-2]);
 				
-				FwtAp scalings[Nhalf];
+				V scalings[Nhalf];
 				for(int i=0; i<Nhalf; i++)
 					scalings[i] = data[2*i];
 				
 				if (lifting)
 					for(int i=0; i<Nhalf; i++)
-						scalings[i] += 0.5 * details[i];
+						scalings[i] += (FwtAp)0.5 * details[i];
 				
 				copy(scalings, scalings + Nhalf, data);
 				copy(details, details + Nhalf, data + Nhalf);
 			}
 			else
 			{
-				FwtAp scalings[Nhalf], details[Nhalf];
+				V scalings[Nhalf], details[Nhalf];
 				copy(data, data + Nhalf, scalings);
 				copy(data + Nhalf, data + N, details);
 								
 				if (lifting)
 					for(int i=0; i<Nhalf; i++)
-						scalings[i] -= 0.5 * details[i];
+						scalings[i] -= (FwtAp)0.5 * details[i];
 				
 				for(int i=0; i<Nhalf; i++)
 					data[2*i] = scalings[i];
@@ -155,32 +228,34 @@ namespace WaveletsOnInterval
 			{
 			if (forward)
 			{
-				FwtAp scalings[Nhalf];
+				const FwtAp half = 0.5;
+
+				V scalings[Nhalf];
 				for(int i=0; i<Nhalf; i++)
-					scalings[i] = 0.5 * (data[2 * i] + data[2 * i + 1]);
+					scalings[i] = half * (data[2 * i] + data[2 * i + 1]);
 
-				FwtAp details[Nhalf];
+				V details[Nhalf];
 
 				// compute first detail
-				details[0] = 0.5 * ((data[1] - data[0]) - (predict1_first(scalings[0], scalings[1], scalings[2]) - predict0_first(scalings[0], scalings[1], scalings[2])));
+				details[0] = half * ((data[1] - data[0]) - (predict1_first(scalings[0], scalings[1], scalings[2]) - predict0_first(scalings[0], scalings[1], scalings[2])));
 
 				// compute middle details
 				for(int i = 1; i < Nhalf - 1; ++i)
 				{
 					const int s = 2 * i;
 
-					details[i] = 0.5 * ((data[s + 1] - data[s]) - (predict1_middle(scalings[i - 1], scalings[i], scalings[i + 1]) - predict0_middle(scalings[i - 1], scalings[i], scalings[i + 1])));
+					details[i] = half * ((data[s + 1] - data[s]) - (predict1_middle(scalings[i - 1], scalings[i], scalings[i + 1]) - predict0_middle(scalings[i - 1], scalings[i], scalings[i + 1])));
 				}
 
 				// compute last detail
-				details[Nhalf-1] = 0.5 * ((data[N-1] - data[N-2]) - (predict1_last(scalings[Nhalf-3], scalings[Nhalf-2], scalings[Nhalf-1]) - predict0_last(scalings[Nhalf-3], scalings[Nhalf-2], scalings[Nhalf-1])));
+				details[Nhalf-1] = half * ((data[N-1] - data[N-2]) - (predict1_last(scalings[Nhalf-3], scalings[Nhalf-2], scalings[Nhalf-1]) - predict0_last(scalings[Nhalf-3], scalings[Nhalf-2], scalings[Nhalf-1])));
 
 				copy(scalings, scalings + Nhalf, data);
 				copy(details, details + Nhalf, data + Nhalf);
 			}
 			else
 			{
-				FwtAp scalings[Nhalf], details[Nhalf];
+				V scalings[Nhalf], details[Nhalf];
 				copy(data, data + Nhalf, scalings);
 				copy(data + Nhalf, data + N, details);
 
@@ -200,78 +275,254 @@ namespace WaveletsOnInterval
 			}	// wtype
 		}
 
+		/* wtypes 4, 5, 6: wtypes 1, 2, 3 factorized into lifting steps that work in place on the
+		   interleaved line (even: scalings, odd: details). the sweeps split the line into
+		   [scalings | details] when they store it back, and interleave it again when they load it */
+		template<int WTYPE>
+		struct InPlace { enum { value = WTYPE >= 4 }; };
+
+		template<const int N, bool forward, int WTYPE, typename V>
+		static inline void lifting(V data[N])
+		{
+			assert(N >= 8);
+			assert(N%2==0);
+
+			enum { Nhalf = N / 2 };
+
+			const FwtAp half = 0.5;
+
+			if ((WTYPE == 4) || (WTYPE == 5))
+			{
+			if (forward)
+			{
+				// predict
+				data[1] -= interp_first(data[0], data[2], data[4], data[6]);
+
+				for(int i = 1; i < Nhalf - 2; ++i)
+					data[2 * i + 1] -= interp_middle(data[2 * i - 2], data[2 * i], data[2 * i + 2], data[2 * i + 4]);
+
+				data[N-3] -= interp_onetolast(data[N-8], data[N-6], data[N-4], data[N-2]);
+				data[N-1] -= interp_last(data[N-8], data[N-6], data[N-4], data[N-2]);
+
+				// update
+				if (WTYPE == 5)
+					for(int i = 0; i < Nhalf; ++i)
+						data[2 * i] += half * data[2 * i + 1];
+			}
+			else
+			{
+				if (WTYPE == 5)
+					for(int i = 0; i < Nhalf; ++i)
+						data[2 * i] -= half * data[2 * i + 1];
+
+				data[1] += interp_first(data[0], data[2], data[4], data[6]);
+
+				for(int i = 1; i < Nhalf - 2; ++i)
+					data[2 * i + 1] += interp_middle(data[2 * i - 2], data[2 * i], data[2 * i + 2], data[2 * i + 4]);
+
+				data[N-3] += interp_onetolast(data[N-8], data[N-6], data[N-4], data[N-2]);
+				data[N-1] += interp_last(data[N-8], data[N-6], data[N-4], data[N-2]);
+			}
+			}
+			else	// wtype == 6
+			{
+			if (forward)
+			{
+				// haar predict and update: h = (b - a)/2, s = a + h
+				for(int i = 0; i < Nhalf; ++i)
+				{
+					data[2 * i + 1] = half * (data[2 * i + 1] - data[2 * i]);
+					data[2 * i] += data[2 * i + 1];
+				}
+
+				// predict the slope from the neighbouring averages
+				data[1] -= slope_first(data[0], data[2], data[4]);
+
+				for(int i = 1; i < Nhalf - 1; ++i)
+					data[2 * i + 1] -= slope_middle(data[2 * i - 2], data[2 * i], data[2 * i + 2]);
+
+				data[N-1] -= slope_last(data[N-6], data[N-4], data[N-2]);
+			}
+			else
+			{
+				data[1] += slope_first(data[0], data[2], data[4]);
+
+				for(int i = 1; i < Nhalf - 1; ++i)
+					data[2 * i + 1] += slope_middle(data[2 * i - 2], data[2 * i], data[2 * i + 2]);
+
+				data[N-1] += slope_last(data[N-6], data[N-4], data[N-2]);
+
+				for(int i = 0; i < Nhalf; ++i)
+				{
+					const V h = data[2 * i + 1];
+
+					data[2 * i + 1] = data[2 * i] + h;
+					data[2 * i] -= h;
+				}
+			}
+			}	// wtype
+		}
+
 	};
 		
 	template<typename WaveletType, int ROWSIZE, int COLSIZE>
 	struct WaveletSweep
 	{
-		template<int BS, bool forward>
-		inline void sweep1D(FwtAp data[BS][ROWSIZE], int wtype)
+		/* as many rows as fit in a SIMD register (but no more than BS) are transformed together */
+		template<int BS>
+		struct RowLanes
 		{
-			for(int iy = 0; iy < BS; ++iy)
-				WaveletType::template transform<BS, forward>(&data[iy][0], wtype);
+			enum { W = (int)FWT_SIMD_WIDTH < BS ? (int)FWT_SIMD_WIDTH : BS };
+
+			typedef typename FwtLanes<W>::V V;
+		};
+
+		/* line element stored in the memory slot i: the in-place lifting keeps the line interleaved */
+		template<int BS, bool interleaved>
+		static inline int _element(const int i)
+		{
+			return interleaved ? (i < BS / 2 ? 2 * i : 2 * i - BS + 1) : i;
 		}
-		
-		template<int BS>
-		inline void xy_transpose(FwtAp data[BS][ROWSIZE])
+
+		template<int BS, bool forward, int WTYPE, typename V>
+		static inline void _transform(V lines[BS])
 		{
-			for(int iy = 0; iy < BS; ++iy)
-					for(int ix = iy + 1; ix < BS; ++ix)
-					{
-						const FwtAp temp = data[iy][ix];
-						data[iy][ix] = data[ix][iy];
-						data[ix][iy] = temp;
-					}
+			if (WaveletType::template InPlace<WTYPE>::value)
+				WaveletType::template lifting<BS, forward, WTYPE>(lines);
+			else
+				WaveletType::template transform<BS, forward, WTYPE>(lines);
 		}
-		
-		template<int BS>
-		inline void xz_transpose(FwtAp data[BS][COLSIZE][ROWSIZE])
+
+		template<int BS, bool forward, int WTYPE>
+		inline void sweep1D(FwtAp data[BS][ROWSIZE])
 		{
-			for(int iy = 0; iy < BS; ++iy)	
-				for(int iz = 0; iz < BS; ++iz)
-					for(int ix = iz + 1; ix < BS; ++ix)
-					{
-						const FwtAp temp = data[iz][iy][ix];
-						data[iz][iy][ix] = data[ix][iy][iz];
-						data[ix][iy][iz] = temp;
-					}
+			enum { inplace = WaveletType::template InPlace<WTYPE>::value };
+			enum { W = RowLanes<BS>::W };
+			typedef typename RowLanes<BS>::V V;
+
+			for(int iy = 0; iy < BS; iy += W)
+			{
+				V lines[BS], tile[BS];
+				FwtAp rows[BS][W];
+
+				// the row gather is a transposition: keep it in memory order and (de)interleave in registers.
+				// the lanes go through rows, not one by one into tile (-Wmaybe-uninitialized)
+				for(int ix = 0; ix < BS; ++ix)
+					for(int l = 0; l < W; ++l)
+						rows[ix][l] = data[iy + l][ix];
+
+				memcpy(tile, rows, sizeof(tile));
+
+				for(int i = 0; i < BS; ++i)
+					lines[_element<BS, inplace && !forward>(i)] = tile[i];
+
+				_transform<BS, forward, WTYPE>(lines);
+
+				for(int i = 0; i < BS; ++i)
+					tile[i] = lines[_element<BS, inplace && forward>(i)];
+
+				for(int ix = 0; ix < BS; ++ix)
+					for(int l = 0; l < W; ++l)
+						data[iy + l][ix] = tile[ix][l];
+			}
 		}
-		
-		template<int BS, bool forward>
-		inline void sweep2D(FwtAp data[BS][ROWSIZE], int wtype)
-		{			
-			sweep1D<BS, forward>(data, wtype);
-			xy_transpose<BS>(data);
-			sweep1D<BS, forward>(data, wtype);
-			//xy_transpose<BS>(data); we don't need this (cross the fingers)
+
+		/* transforms the BS lines that start at base and have their elements stride apart,
+		   together with the WIDTH - 1 lines that follow them in memory (the lanes) */
+		template<int BS, bool forward, int WTYPE, int WIDTH>
+		inline void sweep_lanes(FwtAp * const base, const int stride)
+		{
+			enum { inplace = WaveletType::template InPlace<WTYPE>::value };
+			enum { W = RowLanes<BS>::W };
+			typedef typename RowLanes<BS>::V V;
+
+			for(int ix = 0; ix < WIDTH; ix += W)
+			{
+				V lines[BS];
+
+				for(int i = 0; i < BS; ++i)
+					memcpy(&lines[_element<BS, inplace && !forward>(i)], base + i * stride + ix, sizeof(V));
+
+				_transform<BS, forward, WTYPE>(lines);
+
+				for(int i = 0; i < BS; ++i)
+					memcpy(base + i * stride + ix, &lines[_element<BS, inplace && forward>(i)], sizeof(V));
+			}
 		}
-		
-		template<int BS, bool bForward>
-		inline void sweep3D(FwtAp data[BS][COLSIZE][ROWSIZE], int wtype)
-		{			
-			if(bForward)
+
+		/* as sweep_lanes for the BS lanes, through a tile of TW lanes: lines a plane apart
+		   fall into the same few cache sets, and sweep_lanes would load each cache line
+		   once per register. the tile loads it once and transforms within the L1 cache */
+		template<int BS, bool forward, int WTYPE>
+		inline void sweep_tiled(FwtAp * const base, const int stride)
+		{
+			enum { W = RowLanes<BS>::W };
+			enum { TW = (int)(FWT_TILE_BYTES / sizeof(FwtAp)) < BS ? (int)(FWT_TILE_BYTES / sizeof(FwtAp)) : BS };
+			typedef typename RowLanes<BS>::V V;
+
+			V tile[BS][TW / W];
+			FwtAp * const t = (FwtAp *)tile;
+
+			for(int ix = 0; ix < BS; ix += TW)
 			{
+				for(int i = 0; i < BS; ++i)
+					memcpy(t + i * TW, base + i * stride + ix, TW * sizeof(FwtAp));
+
+				sweep_lanes<BS, forward, WTYPE, TW>(t, TW);
+
+				for(int i = 0; i < BS; ++i)
+					memcpy(base + i * stride + ix, t + i * TW, TW * sizeof(FwtAp));
+			}
+		}
+
+		/* the lines of the BS^3 corner along an axis of the given stride, tiled if they span more than the L1 cache */
+		template<int BS, bool forward, int WTYPE, int STRIDE>
+		inline void sweep_strided(FwtAp * const base)
+		{
+			if (BS * STRIDE * sizeof(FwtAp) > FWT_TILE_SPAN)
+				sweep_tiled<BS, forward, WTYPE>(base, STRIDE);
+			else
+				sweep_lanes<BS, forward, WTYPE, BS>(base, STRIDE);
+		}
+
+		/* 1D transform along the given axis (0: z, 1: y, 2: x) of the BS^3 corner of data */
+		template<int BS, bool forward, int AXIS, int WTYPE>
+		inline void sweep(FwtAp data[BS][COLSIZE][ROWSIZE])
+		{
+			if (AXIS == 2)
 				for(int iz = 0; iz < BS; ++iz)
-					sweep2D<BS, true>(data[iz], wtype);
-				
-				xz_transpose<BS>(data);
-				
+					sweep1D<BS, forward, WTYPE>(data[iz]);
+			else if (AXIS == 1)
 				for(int iz = 0; iz < BS; ++iz)
-					for(int iy = 0; iy < BS; ++iy)
-						WaveletType::template transform<BS, true>(&data[iz][iy][0], wtype);
+					sweep_strided<BS, forward, WTYPE, ROWSIZE>(&data[iz][0][0]);
+			else
+				for(int iy = 0; iy < BS; ++iy)
+					sweep_strided<BS, forward, WTYPE, COLSIZE * ROWSIZE>(&data[0][iy][0]);
+		}
+
+		/* the x, y and z directions of the transform lie on the axes 2, 1 and 0 of data
+		   rotated by ROT (see FullTransformEngine): no transposition is ever performed */
+		template<int BS, bool bForward, int ROT, int WTYPE>
+		inline void sweep3D(FwtAp data[BS][COLSIZE][ROWSIZE])
+		{			
+			enum
+			{
+				XAXIS = (2 + ROT) % 3,
+				YAXIS = (1 + ROT) % 3,
+				ZAXIS = (0 + ROT) % 3
+			};
+
+			if(bForward)
+			{
+				sweep<BS, true, XAXIS, WTYPE>(data);
+				sweep<BS, true, YAXIS, WTYPE>(data);
+				sweep<BS, true, ZAXIS, WTYPE>(data);
 			}
 			else
 			{
-				//xz_transpose(); we don't need this (cross the fingers)
-				
-				for(int iz = 0; iz < BS; ++iz)
-					for(int iy = 0; iy < BS; ++iy)
-						WaveletType::template transform<BS, false>(&data[iz][iy][0], wtype);
-				
-				xz_transpose<BS>(data);
-				
-				for(int iz = 0; iz < BS; ++iz)
-					sweep2D<BS, false>(data[iz], wtype);
+				sweep<BS, false, ZAXIS, WTYPE>(data);
+				sweep<BS, false, YAXIS, WTYPE>(data);
+				sweep<BS, false, XAXIS, WTYPE>(data);
 			}
 		}
 	};
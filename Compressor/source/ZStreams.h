@@ -0,0 +1,101 @@
+/*
+ * ZStreams.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _ZSTREAMS_H_
+#define _ZSTREAMS_H_ 1
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <zlib.h>
+
+/* one deflate and one inflate stream per thread (OpenMP threads included), initialized at
+   the first use and recycled with deflateReset/inflateReset: deflateInit allocates about
+   256 KB of zlib state, that was paid for every block and every chunk */
+class ZStreams
+{
+	z_stream deflater, inflater;
+	bool deflating, inflating;
+	int level, strategy;	// of deflater
+
+	ZStreams(): deflating(false), inflating(false), level(0), strategy(0)
+	{
+		memset(&deflater, 0, sizeof(deflater));
+		memset(&inflater, 0, sizeof(inflater));
+	}
+
+	ZStreams(const ZStreams&);
+	ZStreams& operator=(const ZStreams&);
+
+	static ZStreams& _mine()
+	{
+		static thread_local ZStreams streams;
+		return streams;
+	}
+
+public:
+
+	~ZStreams()
+	{
+		if (deflating) deflateEnd(&deflater);
+		if (inflating) inflateEnd(&inflater);
+	}
+
+	/* the deflate stream of the calling thread, ready for a new stream. it is initialized
+	   again only when the level or the strategy change */
+	static z_stream * deflate_stream(const int level = Z_DEFAULT_COMPRESSION, const int strategy = Z_DEFAULT_STRATEGY)
+	{
+		ZStreams& s = _mine();
+
+		if (s.deflating && (s.level != level || s.strategy != strategy))
+		{
+			deflateEnd(&s.deflater);
+			memset(&s.deflater, 0, sizeof(s.deflater));
+			s.deflating = false;
+		}
+
+		const int retval = s.deflating ? deflateReset(&s.deflater) : deflateInit2(&s.deflater, level, Z_DEFLATED, MAX_WBITS, 8, strategy);
+
+		if (retval != Z_OK)
+		{
+			printf("ZLIB DEFLATE INIT FAILURE!!\n");
+			abort();
+		}
+
+		s.deflating = true;
+		s.level = level;
+		s.strategy = strategy;
+
+		return &s.deflater;
+	}
+
+	/* the inflate stream of the calling thread, ready for a new stream */
+	static z_stream * inflate_stream()
+	{
+		ZStreams& s = _mine();
+
+		const int retval = s.inflating ? inflateReset(&s.inflater) : inflateInit(&s.inflater);
+
+		if (retval != Z_OK)
+		{
+			printf("ZLIB INFLATE INIT FAILURE!!\n");
+			abort();
+		}
+
+		s.inflating = true;
+
+		return &s.inflater;
+	}
+};
+
+#endif
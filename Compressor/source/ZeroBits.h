@@ -0,0 +1,104 @@
+/*
+ * ZeroBits.h
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _ZEROBITS_H_
+#define _ZEROBITS_H_ 1
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* mantissa trimming of the wavelet survivors or of the raw data, before the second stage:
+   the last bits of the mantissa are set to zero, the decoder does not need to know.
+
+	shave:	the bits are cleared (as the old float_zero_bits), relative error below 2^-(m - bits)
+	round:	the value is rounded to the nearest with the remaining bits, half of that error
+
+   with m the bits of the mantissa, 23 for float and 52 for double. inf and nan are left as
+   they are */
+namespace ZeroBits
+{
+	enum Mode { shave = 0, round = 1 };
+
+#if defined(_USE_ZEROBITS_)
+	enum { DEFAULT = _ZEROBITS_ };
+#else
+	enum { DEFAULT = 0 };
+#endif
+
+	struct Settings
+	{
+		int bits;	// of the mantissa set to zero
+		int mode;
+
+		Settings(const int bits = DEFAULT, const int mode = shave): bits(bits), mode(mode) { }
+	};
+
+	inline int mantissa(const int sizeofreal)
+	{
+		return sizeofreal == 4 ? 23 : 52;
+	}
+
+	/* round mode that keeps d significant decimal digits: relative error at most 0.5 10^-d */
+	inline Settings digits(const int d, const int sizeofreal)
+	{
+		const int keep = (int)std::ceil(d * std::log2(10.));
+		return Settings(std::max(0, mantissa(sizeofreal) - keep), round);
+	}
+
+	/* U: the unsigned integer of the size of T */
+	template<typename U, int MANTISSA>
+	inline void _apply(const Settings& settings, U * const data, const int n)
+	{
+		enum { W = 32 / sizeof(U) };	// lanes of a 256-bit register, split by the compiler if narrower
+		typedef U V __attribute__ ((vector_size (W * sizeof(U))));
+
+		const int bits = std::min(settings.bits, MANTISSA);
+		const U mask = ~(((U)1 << bits) - 1);
+		const U half = settings.mode == round && bits > 0 ? (U)1 << (bits - 1) : 0;
+		const U expmask = (((U)1 << (8 * sizeof(U) - 1)) - 1) & ~(((U)1 << MANTISSA) - 1);
+
+		const V vmask = mask - (V){}, vhalf = half - (V){}, vexp = expmask - (V){};
+
+		int i = 0;
+		for(; i + W <= n; i += W)
+		{
+			V v;
+			memcpy(&v, data + i, sizeof(v));
+
+			const V r = (v + vhalf) & vmask;
+			const V special = (V)((v & vexp) == vexp);
+			v = (v & special) | (r & ~special);
+
+			memcpy(data + i, &v, sizeof(v));
+		}
+
+		for(; i < n; ++i)
+		{
+			const U v = data[i];
+			data[i] = (v & expmask) == expmask ? v : (v + half) & mask;
+		}
+	}
+
+	template<typename T>
+	inline void apply(const Settings& settings, T * const data, const int n)
+	{
+		if (settings.bits <= 0) return;
+
+		if (sizeof(T) == 4)
+			_apply<unsigned int, 23>(settings, (unsigned int *)data, n);
+		else
+			_apply<unsigned long long, 52>(settings, (unsigned long long *)data, n);
+	}
+}
+
+#endif
@@ -53,6 +53,55 @@ mymsg 'genref.sh' >> $fout
 mymsg 'test_wavz.sh' >> $fout
 ./test_wavz.sh -1 $nproc | output_filter
 
+# wavelets + zlib, survivors stored in half precision
+mymsg 'test_wavz.sh -halffloat fp16' >> $fout
+./test_wavz.sh -1 $nproc -halffloat fp16 | output_filter
+mymsg 'test_wavz.sh -halffloat bf16' >> $fout
+./test_wavz.sh -1 $nproc -halffloat bf16 | output_filter
+
+# wavelets + zlib, significance map coded as an octree
+mymsg 'test_wavz.sh -sigmap octree' >> $fout
+./test_wavz.sh -1 $nproc -sigmap octree | output_filter
+
+# wavelets + zlib, survivors quantized and coded in bit planes
+mymsg 'test_wavz.sh -quantize bitplane' >> $fout
+./test_wavz.sh -1 $nproc -quantize bitplane | output_filter
+
+# wavelets + zlib, survivors entropy coded with rANS
+mymsg 'test_wavz.sh -encoder rans' >> $fout
+./test_wavz.sh -1 $nproc -encoder rans | output_filter
+mymsg 'test_wavz.sh -encoder rans -shuffle byte' >> $fout
+./test_wavz.sh -1 $nproc -encoder rans -shuffle byte | output_filter
+
+# wavelets + zlib, coder picked per chunk
+mymsg 'test_wavz.sh -encoder adaptive' >> $fout
+./test_wavz.sh -1 $nproc -encoder adaptive | output_filter
+
+# wavelets + zlib, survivors bit shuffled
+mymsg 'test_wavz.sh -shuffle bit' >> $fout
+./test_wavz.sh -1 $nproc -shuffle bit | output_filter
+
+# wavelets + zlib, survivors rounded to significant digits
+mymsg 'test_wavz.sh -digits 4' >> $fout
+./test_wavz.sh -1 $nproc -digits 4 | output_filter
+
+# wavelets + zlib, compression streamed in rounds of blocks
+mymsg 'test_wavz.sh -stream 1' >> $fout
+./test_wavz.sh -1 $nproc -stream 1 | output_filter
+
+# wavelets + zlib, all channels of the file
+mymsg 'test_wavz.sh -channel all' >> $fout
+./test_wavz.sh -1 $nproc -channel all | output_filter
+
+# wavelets + zlib, a container of three records
+rm -f tmp.cz
+mymsg 'test_wavz.sh -step 0' >> $fout
+./test_wavz.sh -1 $nproc -step 0 | output_filter
+mymsg 'test_wavz.sh -step 1' >> $fout
+./test_wavz.sh -1 $nproc -step 1 | output_filter
+mymsg 'test_wavz.sh 0.01 -step 1 -field coarse' >> $fout
+./test_wavz.sh 0.01 $nproc -step 1 -field coarse | output_filter
+
 # zfp
 mymsg 'test_zfp.sh' >> $fout
 ./test_zfp.sh -1 $nproc | output_filter
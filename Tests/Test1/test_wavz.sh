@@ -18,7 +18,7 @@ then
 	err=0.00005
 else
 	err=$1
-	if [ "$1" -eq "-1" ]; then
+	if [ "$1" == "-1" ]; then
 		echo "setting err=0.00005"
 		err=0.00005
 	fi
@@ -31,12 +31,24 @@ then
     nproc=$1; shift
 fi
 
+# the remaining arguments are options of hdf2cz. with -step, tmp.cz is a container:
+# the dump is appended to it and cz2diff reads that record
+hdf2czopts=("$@")
+cz2diffopts=()
+while [ $# -gt 0 ]
+do
+    case "$1" in
+        -step|-field) cz2diffopts+=("$1" "$2"); shift ;;
+    esac
+    shift
+done
+
 bs=32
 ds=128
 nb=$(echo "$ds/$bs" | bc)
 wt=3	# wavelet type
 
-rm -f tmp.cz
+[ ${#cz2diffopts[@]} -eq 0 ] && rm -f tmp.cz
 
 # check if reference file exists, create it otherwise
 if [ ! -f ref.cz ]
@@ -45,6 +57,6 @@ then
 fi
 
 export OMP_NUM_THREADS=$nproc
-mpirun -n 1 ../../Tools/bin/wavz_zlib/hdf2cz -bpdx $nb -bpdy $nb -bpdz $nb -sim io -h5file $h5file -czfile tmp.cz  -threshold $err -wtype $wt
+mpirun -n 1 ../../Tools/bin/wavz_zlib/hdf2cz -bpdx $nb -bpdy $nb -bpdz $nb -sim io -h5file $h5file -czfile tmp.cz  -threshold $err -wtype $wt "${hdf2czopts[@]}"
 
-mpirun -n $nproc ../../Tools/bin/wavz_zlib/cz2diff -czfile1 tmp.cz -wtype $wt -czfile2 ref.cz
+mpirun -n $nproc ../../Tools/bin/wavz_zlib/cz2diff -czfile1 tmp.cz -wtype $wt "${cz2diffopts[@]}" -czfile2 ref.cz
@@ -38,6 +38,7 @@ protected:
 	int BPDX, BPDY, BPDZ;
 	int NPROCX, NPROCY, NPROCZ;
 	int channel;
+	bool allchannels;	// -channel all: the channels interleaved in one file
 	int step_id;
 	bool VERBOSITY;
 	G * grid;
@@ -208,7 +209,11 @@ protected:
 						Real * const ptr_input = array_all + NCHANNELS*(gz + NZ * (gy + NY * gx));
 						Real val = ptr_input[channel];
 
-						b(ix, iy, iz).u = val;
+						if (allchannels)
+							for(int c = 0; c < NCHANNELS; ++c)
+								b(ix, iy, iz).u[c] = ptr_input[c];
+						else
+							b(ix, iy, iz).u[0] = val;
 #if VERBOSE
 						if (val < min_u) min_u = val;
 						if (val > max_u) max_u = val;
@@ -255,7 +260,13 @@ public:
 		BPDZ = parser("-bpdz").asInt(1);
 
 		step_id = parser("-stepid").asInt(0);
-		channel = parser("-channel").asInt(0);
+		allchannels = parser("-channel").asString("0") == "all";
+		channel = allchannels ? 0 : parser("-channel").asInt(0);
+		if (channel < 0 || channel >= TOTAL_CHANNELS)
+		{
+			if (isroot) printf("bad -channel %d (0 to %d, or all)\n", channel, TOTAL_CHANNELS - 1);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
 
 		MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
 
@@ -266,7 +277,7 @@ public:
 
 		if (parser.exist("-help") || ((inputfile_name == "none")||(outputfile_name == "none")))
 		{
-            printf("Usage: %s -h5file <hdf5 file> -czfile <cz file> -threshold <e> [-wtype <wt>] [-bpdx <nbx>] [-bpdy <nby>] [-bpdz <nbz>] [-nprocx <npx>] [-nprocy <npy>] [-nprocz <npz>]\n", "hdf2cz");
+            printf("Usage: %s -h5file <hdf5 file> -czfile <cz file> -threshold <e> [-codec <wavz|fpzip|zfp|sz|none>] [-wtype <wt>] [-halffloat <no|fp16|bf16|fp32>] [-sigmap <bitset|octree>] [-quantize <no|bitplane>] [-shuffle <no|byte|bit>] [-zerobits <n>] [-digits <d>] [-encoder <none|zlib|lz4|lz4hc|rans|adaptive>] [-adaptive <speed|ratio>] [-minratio <r>] [-zlevel <l>] [-zstrategy <default|filtered|huffman|rle>] [-lz4accel <a>] [-lz4hc <level>] [-stream <0|1>] [-channel <c|all>] [-step <n> [-field <name>]] [-bpdx <nbx>] [-bpdy <nby>] [-bpdz <nbz>] [-nprocx <npx>] [-nprocy <npy>] [-nprocz <npz>]\n", "hdf2cz");
 			exit(1);
 		}
 
@@ -322,9 +333,113 @@ public:
 		mywaveletdumper.set_threshold(threshold);
 		mywaveletdumper.set_wtype_write(wtype);
 
+		const string codec = parser("-codec").asString(BlockCodecs::kind_name(BlockCodecs::DEFAULT));
+		if (!BlockCodecs::available(BlockCodecs::parse_kind(codec)))
+		{
+			if (isroot) printf("unknown -codec %s (wavz or none; fpzip, zfp and sz need a build with them)\n", codec.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_codec(BlockCodecs::parse_kind(codec));
+
+		const string halffloat = parser("-halffloat").asString("no");
+		if (HalfFloat::parse(halffloat) < 0)
+		{
+			if (isroot) printf("unknown -halffloat %s (no, fp16, bf16 or fp32)\n", halffloat.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.float16(HalfFloat::parse(halffloat));
+
+		const string sigmap = parser("-sigmap").asString("bitset");
+		if (SignificanceMap::parse(sigmap) < 0)
+		{
+			if (isroot) printf("unknown -sigmap %s (bitset or octree)\n", sigmap.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_sigmap(SignificanceMap::parse(sigmap));
+
+		const string quantize = parser("-quantize").asString("no");
+		if (BitPlane::parse(quantize) < 0)
+		{
+			if (isroot) printf("unknown -quantize %s (no or bitplane)\n", quantize.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_quantizer(BitPlane::parse(quantize));
+
+		const string shuffle = parser("-shuffle").asString(Shuffle::name(Shuffle::DEFAULT));
+		if (Shuffle::parse(shuffle) < 0)
+		{
+			if (isroot) printf("unknown -shuffle %s (no, byte or bit)\n", shuffle.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_shuffle(Shuffle::parse(shuffle));
+
+		// -digits: rounded to d significant digits, -zerobits: n bits shaved
+		const int zerobits = parser("-zerobits").asInt(ZeroBits::DEFAULT);
+		const int digits = parser("-digits").asInt(0);
+		if (zerobits < 0 || zerobits > ZeroBits::mantissa(sizeof(Real)) || digits < 0)
+		{
+			if (isroot) printf("bad -zerobits %d (0 to %d) or -digits %d\n", zerobits, ZeroBits::mantissa(sizeof(Real)), digits);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_zerobits(digits > 0 ? ZeroBits::digits(digits, sizeof(Real)) : ZeroBits::Settings(zerobits));
+
+		// lz4hc: lz4 with LZ4-HC, the same decoder
+		const string encoder = parser("-encoder").asString(Encoder::name(Encoder::DEFAULT));
+		Encoder::Settings settings(Encoder::parse(encoder == "lz4hc" ? "lz4" : encoder));
+		if (!Encoder::available(settings.format))
+		{
+			if (isroot) printf("unknown -encoder %s (none, zlib, lz4, lz4hc, rans or adaptive; lz4 needs a build with lz4=1)\n", encoder.c_str());
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		settings.zlevel = parser("-zlevel").asInt(Z_DEFAULT_COMPRESSION);
+		settings.zstrategy = Encoder::parse_strategy(parser("-zstrategy").asString("default"));
+		if (settings.zlevel < -1 || settings.zlevel > 9 || settings.zstrategy < 0)
+		{
+			if (isroot) printf("bad -zlevel (0 to 9) or -zstrategy (default, filtered, huffman or rle)\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		settings.lz4acceleration = parser("-lz4accel").asInt(1);
+		settings.lz4hclevel = parser("-lz4hc").asInt(encoder == "lz4hc" ? 9 : 0);
+#if !defined(_LZ4_TUNABLE_)
+		if ((settings.format == Encoder::lz4 || settings.format == Encoder::adaptive) && (settings.lz4acceleration != 1 || settings.lz4hclevel != 0))
+		{
+			if (isroot) printf("-lz4accel and LZ4-HC need an LZ4 build against lz4 1.7 or later\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+#endif
+		if (settings.lz4acceleration < 1 || settings.lz4hclevel < 0)
+		{
+			if (isroot) printf("bad -lz4accel %d or -lz4hc %d\n", settings.lz4acceleration, settings.lz4hclevel);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		settings.policy = Encoder::parse_policy(parser("-adaptive").asString("ratio"));
+		settings.minratio = parser("-minratio").asDouble(1.1);
+		if (settings.policy < 0)
+		{
+			if (isroot) printf("bad -adaptive (speed or ratio)\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_encoder(settings);
+		mywaveletdumper.set_streaming(parser("-stream").asBool(false));
+
+		const int step = parser("-step").asInt(-1);
+		const string field = parser("-field").asString("data");
+		if (field.empty() || field.size() >= sizeof(Container::Entry().field))
+		{
+			if (isroot) printf("bad -field %s (1 to %d characters)\n", field.c_str(), (int)sizeof(Container::Entry().field) - 1);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		mywaveletdumper.set_record(step, field);
+
 		MPI_Barrier(MPI_COMM_WORLD);
 		double t0 = MPI_Wtime();
-		mywaveletdumper.Write<0>(grid, streamer.str());
+		if (allchannels)
+			mywaveletdumper.Write_interleaved(grid, streamer.str());
+		else
+			mywaveletdumper.Write<0>(grid, streamer.str());
 		double t1 = MPI_Wtime();
 
 		if (isroot) std::cout << "done" << endl;
@@ -23,6 +23,10 @@ using namespace std;
 
 #include <Grid.h>
 
+#ifndef TOTAL_CHANNELS
+#define TOTAL_CHANNELS 1
+#endif
+
 class Simulation
 {
 public:
@@ -33,14 +37,15 @@ public:
 
 struct FluidElement
 {
-	Real u;
+	Real u[TOTAL_CHANNELS];	// the channels of the input, or the one selected in u[0]
 
-	void clear() { u = 0; }
+	void clear() { for(int c = 0; c < TOTAL_CHANNELS; ++c) u[c] = 0; }
 
 
 	FluidElement& operator = (const FluidElement & gp)
 	{
-		this->u = gp.u;
+		for(int c = 0; c < TOTAL_CHANNELS; ++c)
+			this->u[c] = gp.u[c];
 
 		return *this;
 	}
@@ -85,14 +90,14 @@ struct FluidBlock
 
 struct StreamerGridPointIterative
 {
-	static const int channels = 1;
+	static const int channels = TOTAL_CHANNELS;
 
 	FluidBlock * ref;
 	StreamerGridPointIterative(FluidBlock& b): ref(&b) {}
 	StreamerGridPointIterative(): ref(NULL) {}
 
 	template<int channel>
-	static inline Real operate(const FluidElement& input) { abort(); return 0; }
+	static inline Real operate(const FluidElement& input) { return input.u[channel]; }
 
 	inline Real operate(const int ix, const int iy, const int iz) const
 	{
@@ -104,7 +109,5 @@ struct StreamerGridPointIterative
 	const char * name() { return "StreamerGridPointIterative" ; }
 };
 
-template<> inline Real StreamerGridPointIterative::operate<0>(const FluidElement& e) { return e.u; }
-
 typedef Grid <FluidBlock, std::allocator> FluidGridBase;
 typedef FluidGridBase FluidGrid;
@@ -58,7 +58,7 @@ int main(int argc, char **argv)
 
 	if (argparser.exist("-help") || ((inputfile_name1 == "none")||(inputfile_name2 == "none")))
 	{
-        printf("Usage: %s -czfile1 <cz file1> [-wtype <wt>] -czfile2 <cz reference file2>\n", argv[0]);
+        printf("Usage: %s -czfile1 <cz file1> [-wtype <wt>] [-channel <c>] [-step <n> [-field <name>]] -czfile2 <cz reference file2>\n", argv[0]);
 		exit(1);
 	}
 
@@ -73,8 +73,18 @@ int main(int argc, char **argv)
 	Reader_WaveletCompressionMPI  myreader1(comm, inputfile_name1, swapbytes, wtype);
 	Reader_WaveletCompressionMPI_plain myreader2(comm, inputfile_name2, swapbytes, wtype);
 
+	// the record of czfile1, if it is a container
+	const int step = argparser("-step").asInt(-1);
+	const string field = argparser("-field").asString("data");
+	myreader1.set_record(step, field);
+
 	myreader1.load_file();
 	myreader2.load_file();
+
+	// the channel compared, in the files of several channels
+	const int channel = argparser("-channel").asInt(0);
+	if (myreader1.nchannels() > 1) myreader1.set_channel(channel);
+	if (myreader2.nchannels() > 1) myreader2.set_channel(channel);
 	const double init_t1 = MPI_Wtime();
 
 	const double t0 = MPI_Wtime();
@@ -94,11 +104,12 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	static Real targetdata1[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_];
+	enum { NBATCH = Reader_WaveletCompressionMPI::BATCHBLOCKS };
+
+	static Real targetdata1[NBATCH][_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_];
 	static Real targetdata2[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_];
 
 	const int nblocks = NBX1*NBY1*NBZ1;
-	const int b_end = ((nblocks + (mpi_size - 1))/ mpi_size) * mpi_size;
 
 	long n = 0;
 	double e_inf = 0;
@@ -113,25 +124,35 @@ int main(int argc, char **argv)
 	double maxdata = -DBL_MAX;
 	double mindata =  DBL_MAX;
 
-	for (int b = mpi_rank; b < b_end; b += mpi_size)
+	// the blocks of czfile1 are decompressed NBATCH at a time
+	for (int b0 = mpi_rank; b0 < nblocks; b0 += NBATCH * mpi_size)
 	{
-		int z = b / (NBY1 * NBX1);
-		int y = (b / NBX1) % NBY1;
-		int x = b % NBX1;
+		int xs[NBATCH], ys[NBATCH], zs[NBATCH];
+		int nb = 0;
+
+		for (int b = b0; (b < nblocks) && (nb < NBATCH); b += mpi_size, nb++)
+		{
+			zs[nb] = b / (NBY1 * NBX1);
+			ys[nb] = (b / NBX1) % NBY1;
+			xs[nb] = b % NBX1;
+		}
 
-		if (b < nblocks)
+		double zratio1 = myreader1.load_blocks2(nb, xs, ys, zs, targetdata1);
+		(void)zratio1;	// avoid warnings
+
+		for (int j = 0; j < nb; j++)
 		{
+			int x = xs[j], y = ys[j], z = zs[j];
 #if defined(VERBOSE)
 			fprintf(stdout, "loading block( %d, %d, %d )...\n", x, y, z);
 #endif
-			double zratio1 = myreader1.load_block2(x, y, z, targetdata1);
 			double zratio2 = myreader2.load_block2(x, y, z, targetdata2);
-			(void)zratio1; (void)zratio2;	// avoid warnings
+			(void)zratio2;	// avoid warnings
 
 			for (int zb = 0; zb < _BLOCKSIZE_; zb++)
 				for (int yb = 0; yb < _BLOCKSIZE_; yb++)
 					for (int xb = 0; xb < _BLOCKSIZE_; xb++) {
-						f1 = (double) targetdata1[zb][yb][xb];
+						f1 = (double) targetdata1[j][zb][yb][xb];
 						f2 = (double) targetdata2[zb][yb][xb];
 
 						if (f2 > maxdata) maxdata = f2;
@@ -159,8 +180,6 @@ int main(int argc, char **argv)
 					}
 
 		}
-		else {
-		}
 	}
 
 	MPI_Barrier(MPI_COMM_WORLD);
@@ -235,7 +254,14 @@ int main(int argc, char **argv)
 			int fd = fileno(fpz); //if you have a stream (e.g. from fopen), not a file descriptor.
 			struct stat buf;
 			fstat(fd, &buf);
-			compressed_footprint = buf.st_size;
+			size_t czbytes = buf.st_size;
+			if (step >= 0)
+			{
+				Container::Index index;
+				Container::read(inputfile_name1, index);
+				czbytes = Container::find(index.entries, step, field)->bytes;
+			}
+			compressed_footprint = czbytes / (double)myreader1.nchannels();	// the share of the channel compared
 			fclose(fpz);
 		}
 
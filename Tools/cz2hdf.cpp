@@ -11,6 +11,7 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <mpi.h>
 #include <hdf5.h>
 #include <H5FDmpio.h>
@@ -27,6 +28,20 @@
 #include "ArgumentParser.h"
 #include "Reader_WaveletCompression.h"
 
+static void block_coords(const int b, const int NBX, const int NBY, const int NBZ, int& x, int& y, int& z)
+{
+	(void)NBX; (void)NBZ;	// avoid warnings, each layout needs one of them
+#if defined(_TRANSPOSE_DATA_)
+	x = b / (NBY * NBZ);
+	y = (b / NBZ) % NBY;
+	z = b % NBZ;
+#else
+	z = b / (NBY * NBX);
+	y = (b / NBX) % NBY;
+	x = b % NBX;
+#endif
+}
+
 int main(int argc, char **argv)
 {
 	/* Initialize MPI */
@@ -56,7 +71,7 @@ int main(int argc, char **argv)
 
 	if (argparser.exist("-help") || ((inputfile_name[0] == "none")||(h5file_name == "none")))
 	{
-        printf("Usage: %s -czfile <cz file> -h5file <h5 basefilename> [-wtype <wt>]\n", argv[0]);
+        printf("Usage: %s -czfile <cz file> -h5file <h5 basefilename> [-wtype <wt>] [-lod <k>] [-planes <p>] [-step <n> [-field <name>]]\n", argv[0]);
 		exit(1);
 	}
 
@@ -65,9 +80,9 @@ int main(int argc, char **argv)
 	else
 		argparser.mute();
 
-	int NCHANNELS = 1;
-	if ((inputfile_name[1] != "none")) NCHANNELS++;
-	if ((inputfile_name[2] != "none")) NCHANNELS++;
+	int NFILES = 1;
+	if ((inputfile_name[1] != "none")) NFILES++;
+	if ((inputfile_name[2] != "none")) NFILES++;
 
 	const int Xs = argparser("-xs").asInt(-1);
 	const int Xe = argparser("-xe").asInt(-1);
@@ -78,6 +93,16 @@ int main(int argc, char **argv)
 
 	const bool swapbytes = argparser.check("-swap");
 	const int wtype = argparser("-wtype").asInt(3);	// 3rd order average interpolating wavelets
+	const int lod = argparser("-lod").asInt(0);	// level of detail: blocks downsampled lod times
+	const int planes = argparser("-planes").asInt(BitPlane::MAXPLANES);	// bit planes of quantized survivors
+	const int step = argparser("-step").asInt(-1);	// the record of a container
+	const string field = argparser("-field").asString("data");
+
+	if ((planes < 1) || (planes > BitPlane::MAXPLANES))
+	{
+		printf("Bit planes %d not in [1, %d]\n", planes, (int)BitPlane::MAXPLANES);
+		exit(1);
+	}
 
 	/* HDF5 APIs definitions */
 	hid_t file_id, dset_id; /* file and dataset identifiers */
@@ -89,14 +114,21 @@ int main(int argc, char **argv)
 	hid_t	plist_id; /* property list identifier */
 	herr_t	status;
 
-	Reader_WaveletCompressionMPI *myreader[NCHANNELS];
+	std::vector<Reader_WaveletCompressionMPI *> myreader(NFILES);
 
-	for (int i = 0; i < NCHANNELS; i++)
+	for (int i = 0; i < NFILES; i++)
+	{
 		myreader[i] =  new Reader_WaveletCompressionMPI (comm, inputfile_name[i], swapbytes, wtype);
+		myreader[i]->set_maxplanes(planes);
+		myreader[i]->set_record(step, field);
+	}
 
-	for (int i = 0; i < NCHANNELS; i++)
+	for (int i = 0; i < NFILES; i++)
 		myreader[i]->load_file();
 
+	// a file of several channels (hdf2cz -channel all) has them all, one file per channel otherwise
+	const int NCHANNELS = NFILES == 1 ? myreader[0]->nchannels() : NFILES;
+
 	const double init_t1 = MPI_Wtime();
 
 	const double t0 = MPI_Wtime();
@@ -152,9 +184,20 @@ int main(int argc, char **argv)
 
 	fprintf(stdout, "ROI = [%d,%d]x[%d,%d]x[%d,%d]\n", StartX, EndX, StartY, EndY, StartZ, EndZ);
 
-	int NX = (EndX-StartX+1)*_BLOCKSIZE_;
-	int NY = (EndY-StartY+1)*_BLOCKSIZE_;
-	int NZ = (EndZ-StartZ+1)*_BLOCKSIZE_;
+	if ((lod < 0) || (lod > Reader_WaveletCompressionMPI::MAXLOD))
+	{
+		printf("Level of detail %d not in [0, %d]\n", lod, (int)Reader_WaveletCompressionMPI::MAXLOD);
+		exit(1);
+	}
+
+	// the output blocks, _BLOCKSIZE_ / 2^lod points per direction
+	const int LBS = _BLOCKSIZE_ >> lod;
+	const int LBS3 = LBS * LBS * LBS;
+	if (lod > 0) fprintf(stdout, "LOD = %d (%d^3 points per block)\n", lod, LBS);
+
+	int NX = (EndX-StartX+1)*LBS;
+	int NY = (EndY-StartY+1)*LBS;
+	int NZ = (EndZ-StartZ+1)*LBS;
 
 	/* Create the dataspace for the dataset.*/
 #if defined(_TRANSPOSE_DATA_)
@@ -178,9 +221,9 @@ int main(int argc, char **argv)
 #endif
 	H5Sclose(filespace);
 
-	count[0] = _BLOCKSIZE_;
-	count[1] = _BLOCKSIZE_;
-	count[2] = _BLOCKSIZE_;
+	count[0] = LBS;
+	count[1] = LBS;
+	count[2] = LBS;
 	count[3] = NCHANNELS;
 	memspace = H5Screate_simple(4, count, NULL);
 	nullmemspace = H5Screate_simple(4, count, NULL);
@@ -193,61 +236,85 @@ int main(int argc, char **argv)
 #endif
 
 	static Real *targetdata_all;
-	targetdata_all = (Real *)malloc(_BLOCKSIZE_*_BLOCKSIZE_*_BLOCKSIZE_*NCHANNELS*sizeof(Real));
-	static Real targetdata[_BLOCKSIZE_][_BLOCKSIZE_][_BLOCKSIZE_];
+	targetdata_all = (Real *)malloc(LBS3*NCHANNELS*sizeof(Real));
 
 #if defined(_TRANSPOSE_DATA_)
 	static Real *storedata;
-	storedata = (Real *)malloc(_BLOCKSIZE_*_BLOCKSIZE_*_BLOCKSIZE_*NCHANNELS*sizeof(Real));
+	storedata = (Real *)malloc(LBS3*NCHANNELS*sizeof(Real));
 #endif
 
 	const int nblocks = NBX*NBY*NBZ;
 	const int b_end = ((nblocks + (mpi_size - 1))/ mpi_size) * mpi_size;
 
+	// the blocks of this rank are decompressed NBATCH at a time, ahead of their writing
+	enum { NBATCH = Reader_WaveletCompressionMPI::BATCHBLOCKS };
+	std::vector< std::vector<Real> > targetbatch(NCHANNELS, std::vector<Real>(NBATCH*LBS3));
+	int nbatch = 0, ibatch = 0;
+
 	for (int b = mpi_rank; b < b_end; b += mpi_size)
 	{
-#if defined(_TRANSPOSE_DATA_)
-		int x = b / (NBY * NBZ);
-		int y = (b / NBZ) % NBY;
-		int z = b % NBZ;
-#else
-		int z = b / (NBY * NBX);
-		int y = (b / NBX) % NBY;
-		int x = b % NBX;
-#endif
+		int x, y, z;
+		block_coords(b, NBX, NBY, NBZ, x, y, z);
+
 		int in_roi = (StartX <= x) && (x <= EndX) && (StartY <= y) && (y <= EndY) && (StartZ <= z) && (z <= EndZ);
 		if ((b < nblocks) && (in_roi))
 		{
 #if defined(VERBOSE)
 			fprintf(stdout, "loading block( %d, %d, %d )...\n", x, y, z);
 #endif
+			if (ibatch == nbatch)
+			{
+				int xs[NBATCH], ys[NBATCH], zs[NBATCH];
+				nbatch = ibatch = 0;
 
-			memset(targetdata_all, 0, NCHANNELS*_BLOCKSIZE_*_BLOCKSIZE_*_BLOCKSIZE_*sizeof(Real));
+				for (int bb = b; (bb < nblocks) && (nbatch < NBATCH); bb += mpi_size)
+				{
+					int xx, yy, zz;
+					block_coords(bb, NBX, NBY, NBZ, xx, yy, zz);
 
-			for (int i = 0; i < NCHANNELS; i++)
-			{
-			double zratio = myreader[i]->load_block2(x, y, z, targetdata);
-			(void)zratio;
+					if ((StartX <= xx) && (xx <= EndX) && (StartY <= yy) && (yy <= EndY) && (StartZ <= zz) && (zz <= EndZ))
+					{
+						xs[nbatch] = xx; ys[nbatch] = yy; zs[nbatch] = zz;
+						nbatch++;
+					}
+				}
+
+				for (int i = 0; i < NCHANNELS; i++)
+				{
+				Reader_WaveletCompressionMPI * const reader = myreader[NFILES == 1 ? 0 : i];
+				reader->set_channel(NFILES == 1 ? i : 0);
+
+				double zratio = reader->load_blocks_lod(nbatch, xs, ys, zs, lod, &targetbatch[i].front());
+				(void)zratio;
 #if defined(VERBOSE)
-			fprintf(stdout, "compression ratio was %.2lf\n", zratio);
+				fprintf(stdout, "compression ratio was %.2lf\n", zratio);
 #endif
+				}
+			}
+
+			memset(targetdata_all, 0, NCHANNELS*LBS3*sizeof(Real));
+
+			for (int i = 0; i < NCHANNELS; i++)
+			{
+			const Real *targetdata = &targetbatch[i][ibatch*LBS3];
 
-			for (int xb = 0; xb < _BLOCKSIZE_; xb++)
-				for (int yb = 0; yb < _BLOCKSIZE_; yb++)
-					for (int zb = 0; zb < _BLOCKSIZE_; zb++)
+			for (int xb = 0; xb < LBS; xb++)
+				for (int yb = 0; yb < LBS; yb++)
+					for (int zb = 0; zb < LBS; zb++)
 					{
-						targetdata_all[i + zb*NCHANNELS + yb*NCHANNELS*_BLOCKSIZE_ + xb*NCHANNELS*_BLOCKSIZE_*_BLOCKSIZE_] = targetdata[xb][yb][zb];
+						targetdata_all[i + zb*NCHANNELS + yb*NCHANNELS*LBS + xb*NCHANNELS*LBS*LBS] = targetdata[zb + LBS*(yb + LBS*xb)];
 					}
 			}
+			ibatch++;
 
 #if defined(_TRANSPOSE_DATA_)
 			for (int i = 0; i < NCHANNELS; i++)
 			{
-			for (int xb = 0; xb < _BLOCKSIZE_; xb++)
-				for (int yb = 0; yb < _BLOCKSIZE_; yb++)
-					for (int zb = 0; zb < _BLOCKSIZE_; zb++) {
-						storedata[i + xb*NCHANNELS + yb*NCHANNELS*_BLOCKSIZE_ + zb*NCHANNELS*_BLOCKSIZE_*_BLOCKSIZE_] =
-						targetdata_all[i + zb*NCHANNELS + yb*NCHANNELS*_BLOCKSIZE_ + xb*NCHANNELS*_BLOCKSIZE_*_BLOCKSIZE_];
+			for (int xb = 0; xb < LBS; xb++)
+				for (int yb = 0; yb < LBS; yb++)
+					for (int zb = 0; zb < LBS; zb++) {
+						storedata[i + xb*NCHANNELS + yb*NCHANNELS*LBS + zb*NCHANNELS*LBS*LBS] =
+						targetdata_all[i + zb*NCHANNELS + yb*NCHANNELS*LBS + xb*NCHANNELS*LBS*LBS];
 
 					}
 			}
@@ -304,9 +371,9 @@ int main(int argc, char **argv)
 
 
 	/* Close/release resources */
-	for (int channel = 0; channel < NCHANNELS; channel++)
+	for (int i = 0; i < NFILES; i++)
 	{
-		delete myreader[channel];
+		delete myreader[i];
 	}
 
 	H5Sclose(memspace);
@@ -0,0 +1,88 @@
+/*
+ * fwtbench.cpp
+ * CubismZ
+ *
+ * Copyright 2018 ETH Zurich. All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <mpi.h>
+
+#include "ArgumentParser.h"
+#include "FullWaveletTransform.h"
+
+using namespace WaveletsOnInterval;
+
+/* throughput of the forward and inverse wavelet transform of one block, for the
+   block sizes the tools can be compiled with (the blocksize= option) */
+template<int BS>
+void bench(const int wtype, const double mbytes)
+{
+	FullTransform<BS> * const t = new FullTransform<BS>;
+	FwtAp * const data = &t->data[0][0][0];
+
+	for(int i = 0; i < BS * BS * BS; ++i)
+		data[i] = sin(0.01 * i) + cos(0.003 * (i % (BS * BS)));
+
+	const double blockbytes = BS * BS * BS * sizeof(FwtAp);
+	const int reps = max(4, (int)(mbytes * 1e6 / blockbytes));
+
+	// warm up
+	t->fwt(wtype);
+	t->iwt(wtype);
+
+	double tfwt = 0, tiwt = 0;
+
+	for(int r = 0; r < reps; ++r)
+	{
+		const double t0 = MPI_Wtime();
+		t->fwt(wtype);
+		const double t1 = MPI_Wtime();
+		t->iwt(wtype);
+		const double t2 = MPI_Wtime();
+
+		tfwt += t1 - t0;
+		tiwt += t2 - t1;
+	}
+
+	const double mb = reps * blockbytes / 1e6;
+
+	printf("%4d %9.0f %9.1f %9.1f %9.1f\n", BS, blockbytes / 1024, mb / tfwt, mb / tiwt, 1e6 * (tfwt + tiwt) / reps);
+
+	delete t;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc, &argv);
+
+	ArgumentParser argparser(argc, (const char **)argv);
+
+	if (argparser.exist("-help"))
+	{
+		printf("Usage: %s [-wtype <wt>] [-mbytes <MB transformed per block size>]\n", argv[0]);
+		exit(1);
+	}
+
+	argparser.loud();
+
+	const int wtype = argparser("-wtype").asInt(3);
+	const double mbytes = argparser("-mbytes").asDouble(1024);
+
+	printf("wavelets: %s, %d-byte %s, %d lanes\n", ChosenWavelets_GetName(wtype),
+		   (int)sizeof(FwtAp), sizeof(FwtAp) == 4 ? "float" : "double", (int)FWT_SIMD_WIDTH);
+	printf("  bs  block-kb  fwt-mb/s  iwt-mb/s  us/block\n");
+
+	bench<16>(wtype, mbytes);
+	bench<32>(wtype, mbytes);
+	bench<64>(wtype, mbytes);
+	bench<128>(wtype, mbytes);
+
+	MPI_Finalize();
+
+	return 0;
+}
@@ -22,15 +22,22 @@ int main (int argc, char ** argv)
 {
 	int provided;
 #ifdef _OPENMP
-	MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+	const int required = MPI_THREAD_SERIALIZED;	// the threads write the slabs with -stream 1
 #else
-	MPI_Init_thread(&argc, &argv, MPI_THREAD_SINGLE, &provided);
+	const int required = MPI_THREAD_SINGLE;
 #endif
+	MPI_Init_thread(&argc, &argv, required, &provided);
 
 	int myrank;
 	MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
 	const bool isroot = myrank == 0;
 
+	if (provided < required)
+	{
+		if (isroot) printf("the MPI library provides thread level %d, %d is needed\n", provided, required);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
 	ArgumentParser parser (argc, (const char **)argv);
 
 	parser.set_strict_mode();